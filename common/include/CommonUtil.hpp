@@ -25,11 +25,18 @@
 
 #include <cstdint>
 
+#if defined(_MSC_VER)
+#include <xmmintrin.h>
+#endif
+
 namespace datasketches {
 
 class CommonUtil final {
   public:
     static unsigned int getNumberOfLeadingZeros(uint64_t x);
+
+    // hint to bring the cache line containing ptr closer to the core ahead of a write
+    static void prefetch(const void* ptr);
 };
 
 #define FCLZ_MASK_56 ((uint64_t) 0x00ffffffffffffff)
@@ -65,6 +72,13 @@ inline unsigned int CommonUtil::getNumberOfLeadingZeros(const uint64_t x) {
 
 }
 
+inline void CommonUtil::prefetch(const void* ptr) {
+#if defined(_MSC_VER)
+  _mm_prefetch(static_cast<const char*>(ptr), _MM_HINT_T0);
+#else
+  __builtin_prefetch(ptr, 1, 3);
+#endif
+}
 
 }
 
@@ -50,7 +50,7 @@ else
   endif
 endif
 
-TSTLNKFLAGS := -Wl,-rpath=/usr/local/lib
+TSTLNKFLAGS := -Wl,-rpath=/usr/local/lib -pthread
 
 ifeq ($(COVERAGE),1)
   #ifeq (clang,$(findstring clang,$(CC)))
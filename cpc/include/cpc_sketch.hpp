@@ -95,6 +95,12 @@ class cpc_sketch_alloc {
     // which does widening conversion to int64_t, if compatibility with Java is expected
     void update(const void* value, int size);
 
+    // Update with a hash computed by the caller as MurmurHash3_x64_128(value, size, seed),
+    // where h0 and h1 are the two 64-bit halves of the result (HashState::h1 and h2).
+    // Equivalent to update(value, size), so the same hash can feed several sketches.
+    // Throws if the seed differs from the seed of this sketch.
+    void update_hashed(uint64_t h0, uint64_t h1, uint64_t seed = DEFAULT_SEED);
+
     // prints a sketch summary to a given stream
     void to_stream(std::ostream& os) const;
 
@@ -187,6 +187,12 @@ void cpc_sketch_alloc<A>::update(const void* value, int size) {
   row_col_update(row_col_from_two_hashes(hashes.h1, hashes.h2, lg_k));
 }
 
+template<typename A>
+void cpc_sketch_alloc<A>::update_hashed(uint64_t h0, uint64_t h1, uint64_t seed) {
+  if (seed != this->seed) throw std::invalid_argument("seed mismatch: expected " + std::to_string(this->seed) + ", actual " + std::to_string(seed));
+  row_col_update(row_col_from_two_hashes(h0, h1, lg_k));
+}
+
 template<typename A>
 void cpc_sketch_alloc<A>::row_col_update(uint32_t row_col) {
   const uint8_t col = row_col & 63;
@@ -55,6 +55,7 @@ class cpc_sketch_test: public CppUnit::TestFixture {
   CPPUNIT_TEST(update_int_equivalence);
   CPPUNIT_TEST(update_float_equivalence);
   CPPUNIT_TEST(update_string_equivalence);
+  CPPUNIT_TEST(update_hashed_equivalence);
   CPPUNIT_TEST_SUITE_END();
 
   void lg_k_limits() {
@@ -396,6 +397,19 @@ class cpc_sketch_test: public CppUnit::TestFixture {
     CPPUNIT_ASSERT_DOUBLES_EQUAL(1, sketch.get_estimate(), RELATIVE_ERROR_FOR_LG_K_11);
   }
 
+  void update_hashed_equivalence() {
+    cpc_sketch sketch1(11, 123);
+    cpc_sketch sketch2(11, 123);
+    for (uint64_t i = 0; i < 10000; i++) {
+      sketch1.update(i);
+      HashState hashes;
+      MurmurHash3_x64_128(&i, sizeof(i), 123, hashes);
+      sketch2.update_hashed(hashes.h1, hashes.h2, 123);
+    }
+    CPPUNIT_ASSERT_EQUAL(sketch1.get_estimate(), sketch2.get_estimate());
+    CPPUNIT_ASSERT_THROW(sketch2.update_hashed(1, 1), std::invalid_argument);
+  }
+
 };
 
 CPPUNIT_TEST_SUITE_REGISTRATION(cpc_sketch_test);
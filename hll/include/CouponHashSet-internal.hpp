@@ -124,10 +124,10 @@ CouponHashSet<A>* CouponHashSet<A>::newSet(const void* bytes, size_t len) {
     typedef typename std::allocator_traits<A>::template rebind_alloc<int> intAlloc;
     sketch->couponIntArr = intAlloc().allocate(1 << lgArrInts);
     sketch->couponCount = couponCount;
-    // only need to read valid coupons, unlike in stream case
+    // the whole hash table, valid coupons are spread across it
     std::memcpy(sketch->couponIntArr,
                 data + HllUtil<A>::HASH_SET_INT_ARR_START,
-                couponCount * sizeof(int));
+                couponsInArray * sizeof(int));
     intAlloc().deallocate(oldArr, oldArrLen);
   }
 
@@ -80,6 +80,7 @@ class CouponList : public HllSketchImpl<A> {
     int* couponIntArr;
 
     friend class HllSketchImplFactory<A>;
+    friend class hll_union_alloc<A>;
 };
 
 }
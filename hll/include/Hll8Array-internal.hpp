@@ -129,6 +129,110 @@ HllSketchImpl<A>* Hll8Array<A>::couponUpdate(const int coupon) { // used by HLL_
   return this;
 }
 
+template<typename A>
+void Hll8Array<A>::mergeHll(const HllArray<A>& src) {
+  const uint8_t* auxInts = nullptr;
+  int numAuxInts = 0;
+  AuxHashMap<A>* auxHashMap = src.getAuxHashMap();
+  if (auxHashMap != nullptr) {
+    auxInts = reinterpret_cast<const uint8_t*>(auxHashMap->getAuxIntArr());
+    numAuxInts = 1 << auxHashMap->getLgAuxArrInts();
+  }
+  mergeHll(src.getLgConfigK(), src.getTgtHllType(), src.hllByteArr, src.getCurMin(), auxInts, numAuxInts);
+}
+
+template<typename A>
+void Hll8Array<A>::mergeHll(const int srcLgConfigK, const target_hll_type srcTgtHllType,
+                            const uint8_t* srcArr, const int srcCurMin,
+                            const uint8_t* auxInts, const int numAuxInts) {
+  const int srcK = 1 << srcLgConfigK;
+  const int tgtK = 1 << this->lgConfigK;
+  if (srcK < tgtK) {
+    throw std::invalid_argument("Source lgConfigK must not be smaller than target lgConfigK");
+  }
+  const int tgtMask = tgtK - 1;
+  uint8_t* tgtArr = this->hllByteArr;
+  // net change in the number of slots at each value, to update kxq without a rescan
+  int deltas[HllUtil<A>::VAL_MASK_6 + 1] = {};
+  // a larger source folds onto this array, slot i going to slot i mod tgtK
+  switch (srcTgtHllType) {
+    case HLL_8:
+      for (int offset = 0; offset < srcK; offset += tgtK) {
+        const uint8_t* srcRun = srcArr + offset;
+        for (int i = 0; i < tgtK; i++) {
+          mergeSlot(tgtArr[i], srcRun[i] & HllUtil<A>::VAL_MASK_6, deltas);
+        }
+      }
+      break;
+    case HLL_6:
+      // 4 slots of 6 bits in every 3 bytes, lowest bits first
+      for (int slotNo = 0; slotNo < srcK; slotNo += 4, srcArr += 3) {
+        const uint32_t bits = srcArr[0] | (srcArr[1] << 8) | (srcArr[2] << 16);
+        uint8_t* tgtRun = tgtArr + (slotNo & tgtMask);
+        for (int i = 0; i < 4; i++) {
+          mergeSlot(tgtRun[i], (bits >> (i * 6)) & HllUtil<A>::VAL_MASK_6, deltas);
+        }
+      }
+      break;
+    case HLL_4: {
+      // values are offsets from curMin, exceptions are merged from the aux entries below
+      const uint8_t curMin = static_cast<uint8_t>(srcCurMin);
+      for (int slotNo = 0; slotNo < srcK; slotNo += 2, srcArr++) {
+        uint8_t* tgtRun = tgtArr + (slotNo & tgtMask);
+        const uint8_t nibbles[2] = {
+          static_cast<uint8_t>(*srcArr & HllUtil<A>::loNibbleMask),
+          static_cast<uint8_t>(*srcArr >> 4)
+        };
+        for (int i = 0; i < 2; i++) {
+          if (nibbles[i] == HllUtil<A>::AUX_TOKEN) continue;
+          mergeSlot(tgtRun[i], (nibbles[i] + curMin) & HllUtil<A>::VAL_MASK_6, deltas);
+        }
+      }
+      // aux entries are (slot, value) pairs, possibly unaligned when read from serialized bytes
+      for (int i = 0; i < numAuxInts; i++) {
+        int pair;
+        std::memcpy(&pair, auxInts + i * sizeof(int), sizeof(int));
+        if (pair == HllUtil<A>::EMPTY) continue;
+        const int slotNo = HllUtil<A>::getLow26(pair) & tgtMask;
+        mergeSlot(tgtArr[slotNo], HllUtil<A>::getValue(pair) & HllUtil<A>::VAL_MASK_6, deltas);
+      }
+      break;
+    }
+  }
+  for (int value = 0; value <= HllUtil<A>::VAL_MASK_6; value++) {
+    if (deltas[value] == 0) continue;
+    if (value < 32) this->kxq0 += deltas[value] * HllUtil<A>::invPow2(value);
+    else this->kxq1 += deltas[value] * HllUtil<A>::invPow2(value);
+  }
+  this->numAtCurMin += deltas[0];
+}
+
+template<typename A>
+inline void Hll8Array<A>::mergeSlot(uint8_t& slot, uint8_t value, int* deltas) {
+  if (value > slot) {
+    deltas[slot]--;
+    deltas[value]++;
+    slot = value;
+  }
+}
+
+template<typename A>
+void Hll8Array<A>::rebuildKxQNumZeros() {
+  // a histogram of values avoids a branch and a conversion per slot
+  const int configK = 1 << this->lgConfigK;
+  int counts[HllUtil<A>::VAL_MASK_6 + 1] = {};
+  for (int i = 0; i < configK; i++) {
+    counts[this->hllByteArr[i] & HllUtil<A>::VAL_MASK_6]++;
+  }
+  double kxq0 = 0;
+  double kxq1 = 0;
+  for (int value = 0; value < 32; value++) kxq0 += counts[value] * HllUtil<A>::invPow2(value);
+  for (int value = 32; value <= HllUtil<A>::VAL_MASK_6; value++) kxq1 += counts[value] * HllUtil<A>::invPow2(value);
+  this->numAtCurMin = counts[0];
+  this->kxq0 = kxq0;
+  this->kxq1 = kxq1;
+}
+
 }
 
 #endif // _HLL8ARRAY_INTERNAL_HPP_
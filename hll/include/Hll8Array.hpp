@@ -46,10 +46,23 @@ class Hll8Array final : public HllArray<A> {
 
     virtual HllSketchImpl<A>* couponUpdate(int coupon) final;
 
+    // Merges the registers of an HLL array of any type with lgConfigK not smaller than this one
+    // by taking the maximum slot by slot, adjusting kxq0, kxq1 and the number of zeros
+    // by the net change at each value. The HIP accumulator is left as is,
+    // callers deal with it and the out-of-order flag.
+    void mergeHll(const HllArray<A>& src);
+    // merges registers given in their serialized layout, aux (HLL_4 exception) entries as pair ints
+    void mergeHll(int srcLgConfigK, target_hll_type srcTgtHllType, const uint8_t* srcArr,
+                  int srcCurMin, const uint8_t* auxInts, int numAuxInts);
+
     virtual int getHllByteArrBytes() const;
 
   protected:
+    void rebuildKxQNumZeros();
+    static void mergeSlot(uint8_t& slot, uint8_t value, int* deltas);
+
     friend class Hll8Iterator<A>;
+    friend class concurrent_hll_sketch_alloc<A>;
 };
 
 template<typename A>
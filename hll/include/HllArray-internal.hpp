@@ -29,6 +29,7 @@
 
 #include <cstring>
 #include <cmath>
+#include <limits>
 #include <stdexcept>
 #include <string>
 
@@ -44,6 +45,10 @@ HllArray<A>::HllArray(const int lgConfigK, const target_hll_type tgtHllType, boo
   numAtCurMin = 1 << lgConfigK;
   oooFlag = false;
   hllByteArr = nullptr; // allocated in derived class
+  cachedKxQSum = std::numeric_limits<double>::quiet_NaN();
+  cachedCurMin = 0;
+  cachedNumAtCurMin = 0;
+  cachedCompositeEstimate = 0;
 }
 
 template<typename A>
@@ -55,6 +60,10 @@ HllArray<A>::HllArray(const HllArray<A>& that)
   curMin = that.getCurMin();
   numAtCurMin = that.getNumAtCurMin();
   oooFlag = that.isOutOfOrderFlag();
+  cachedKxQSum = that.cachedKxQSum;
+  cachedCurMin = that.cachedCurMin;
+  cachedNumAtCurMin = that.cachedNumAtCurMin;
+  cachedCompositeEstimate = that.cachedCompositeEstimate;
 
   // can determine length, so allocate here
   const int arrayLen = that.getHllByteArrBytes();
@@ -84,13 +93,16 @@ HllArray<A>* HllArray<A>::copyAs(const target_hll_type tgtHllType) const {
   if (tgtHllType == this->getTgtHllType()) {
     return static_cast<HllArray*>(copy());
   }
+  HllArray* result;
   if (tgtHllType == target_hll_type::HLL_4) {
-    return HllSketchImplFactory<A>::convertToHll4(*this);
+    result = HllSketchImplFactory<A>::convertToHll4(*this);
   } else if (tgtHllType == target_hll_type::HLL_6) {
-    return HllSketchImplFactory<A>::convertToHll6(*this);
+    result = HllSketchImplFactory<A>::convertToHll6(*this);
   } else { // tgtHllType == HLL_8
-    return HllSketchImplFactory<A>::convertToHll8(*this);
+    result = HllSketchImplFactory<A>::convertToHll8(*this);
   }
+  if (oooFlag) result->refreshCompositeEstimate();
+  return result;
 }
 
 template<typename A>
@@ -158,6 +170,7 @@ HllArray<A>* HllArray<A>::newHll(const void* bytes, size_t len) {
   if (auxHashMap != nullptr)
     ((Hll4Array<A>*)sketch)->putAuxHashMap(auxHashMap);
 
+  if (oooFlag) sketch->refreshCompositeEstimate();
   return sketch;
 }
 
@@ -215,6 +228,7 @@ HllArray<A>* HllArray<A>::newHll(std::istream& is) {
     ((Hll4Array<A>*)sketch)->putAuxHashMap(auxHashMap);
   }
 
+  if (oooFlag) sketch->refreshCompositeEstimate();
   return sketch;
 }
 
@@ -351,49 +365,45 @@ double HllArray<A>::getEstimate() const {
  */
 template<typename A>
 double HllArray<A>::getLowerBound(const int numStdDev) const {
+  const double estimate = oooFlag ? getCompositeEstimate() : hipAccum;
+  return computeLowerBound(this->lgConfigK, oooFlag, estimate, curMin, numAtCurMin, numStdDev);
+}
+
+template<typename A>
+double HllArray<A>::getUpperBound(const int numStdDev) const {
+  const double estimate = oooFlag ? getCompositeEstimate() : hipAccum;
+  return computeUpperBound(this->lgConfigK, oooFlag, estimate, numStdDev);
+}
+
+template<typename A>
+double HllArray<A>::computeLowerBound(const int lgConfigK, const bool oooFlag, const double estimate,
+                                      const int curMin, const int numAtCurMin, const int numStdDev) {
   HllUtil<A>::checkNumStdDev(numStdDev);
-  const int configK = 1 << this->lgConfigK;
+  const int configK = 1 << lgConfigK;
   const double numNonZeros = ((curMin == 0) ? (configK - numAtCurMin) : configK);
-
-  double estimate;
-  double rseFactor;
-  if (oooFlag) {
-    estimate = getCompositeEstimate();
-    rseFactor = HllUtil<A>::HLL_NON_HIP_RSE_FACTOR;
-  } else {
-    estimate = hipAccum;
-    rseFactor = HllUtil<A>::HLL_HIP_RSE_FACTOR;
-  }
+  const double rseFactor = oooFlag ? HllUtil<A>::HLL_NON_HIP_RSE_FACTOR : HllUtil<A>::HLL_HIP_RSE_FACTOR;
 
   double relErr;
-  if (this->lgConfigK > 12) {
+  if (lgConfigK > 12) {
     relErr = (numStdDev * rseFactor) / sqrt(configK);
   } else {
-    relErr = HllUtil<A>::getRelErr(false, oooFlag, this->lgConfigK, numStdDev);
+    relErr = HllUtil<A>::getRelErr(false, oooFlag, lgConfigK, numStdDev);
   }
   return fmax(estimate / (1.0 + relErr), numNonZeros);
 }
 
 template<typename A>
-double HllArray<A>::getUpperBound(const int numStdDev) const {
+double HllArray<A>::computeUpperBound(const int lgConfigK, const bool oooFlag, const double estimate,
+                                      const int numStdDev) {
   HllUtil<A>::checkNumStdDev(numStdDev);
-  const int configK = 1 << this->lgConfigK;
-
-  double estimate;
-  double rseFactor;
-  if (oooFlag) {
-    estimate = getCompositeEstimate();
-    rseFactor = HllUtil<A>::HLL_NON_HIP_RSE_FACTOR;
-  } else {
-    estimate = hipAccum;
-    rseFactor = HllUtil<A>::HLL_HIP_RSE_FACTOR;
-  }
+  const int configK = 1 << lgConfigK;
+  const double rseFactor = oooFlag ? HllUtil<A>::HLL_NON_HIP_RSE_FACTOR : HllUtil<A>::HLL_HIP_RSE_FACTOR;
 
   double relErr;
-  if (this->lgConfigK > 12) {
+  if (lgConfigK > 12) {
     relErr = (-1.0) * (numStdDev * rseFactor) / sqrt(configK);
   } else {
-    relErr = HllUtil<A>::getRelErr(true, oooFlag, this->lgConfigK, numStdDev);
+    relErr = HllUtil<A>::getRelErr(true, oooFlag, lgConfigK, numStdDev);
   }
   return estimate / (1.0 + relErr);
 }
@@ -407,11 +417,33 @@ double HllArray<A>::getUpperBound(const int numStdDev) const {
 // Original C: again-two-registers.c hhb_get_composite_estimate L1489
 template<typename A>
 double HllArray<A>::getCompositeEstimate() const {
-  const double rawEst = getHllRawEstimate(this->lgConfigK, kxq0 + kxq1);
+  const double kxqSum = kxq0 + kxq1;
+  if (kxqSum == cachedKxQSum && curMin == cachedCurMin && numAtCurMin == cachedNumAtCurMin) {
+    return cachedCompositeEstimate;
+  }
+  return computeCompositeEstimate(this->lgConfigK, kxqSum, curMin, numAtCurMin);
+}
+
+template<typename A>
+void HllArray<A>::refreshCompositeEstimate() {
+  const double kxqSum = kxq0 + kxq1;
+  if (kxqSum == cachedKxQSum && curMin == cachedCurMin && numAtCurMin == cachedNumAtCurMin) {
+    return;
+  }
+  cachedCompositeEstimate = computeCompositeEstimate(this->lgConfigK, kxqSum, curMin, numAtCurMin);
+  cachedKxQSum = kxqSum;
+  cachedCurMin = curMin;
+  cachedNumAtCurMin = numAtCurMin;
+}
+
+template<typename A>
+double HllArray<A>::computeCompositeEstimate(const int lgConfigK, const double kxqSum,
+                                               const int curMin, const int numAtCurMin) {
+  const double rawEst = getHllRawEstimate(lgConfigK, kxqSum);
 
-  const double* xArr = CompositeInterpolationXTable<A>::get_x_arr(this->lgConfigK);
-  const int xArrLen = CompositeInterpolationXTable<A>::get_x_arr_length(this->lgConfigK);
-  const double yStride = CompositeInterpolationXTable<A>::get_y_stride(this->lgConfigK);
+  const double* xArr = CompositeInterpolationXTable<A>::get_x_arr(lgConfigK);
+  const int xArrLen = CompositeInterpolationXTable<A>::get_x_arr_length(lgConfigK);
+  const double yStride = CompositeInterpolationXTable<A>::get_y_stride(lgConfigK);
 
   if (rawEst < xArr[0]) {
     return 0;
@@ -430,12 +462,12 @@ double HllArray<A>::getCompositeEstimate() const {
   // We need to completely avoid the linear_counting estimator if it might have a crazy value.
   // Empirical evidence suggests that the threshold 3*k will keep us safe if 2^4 <= k <= 2^21.
 
-  if (adjEst > (3 << this->lgConfigK)) { return adjEst; }
+  if (adjEst > (3 << lgConfigK)) { return adjEst; }
   //Alternate call
-  //if ((adjEst > (3 << this->lgConfigK)) || ((curMin != 0) || (numAtCurMin == 0)) ) { return adjEst; }
+  //if ((adjEst > (3 << lgConfigK)) || ((curMin != 0) || (numAtCurMin == 0)) ) { return adjEst; }
 
   const double linEst =
-      getHllBitMapEstimate(this->lgConfigK, curMin, numAtCurMin);
+      getHllBitMapEstimate(lgConfigK, curMin, numAtCurMin);
 
   // Bias is created when the value of an estimator is compared with a threshold to decide whether
   // to use that estimator or a different one.
@@ -447,10 +479,10 @@ double HllArray<A>::getCompositeEstimate() const {
   // The following constants comes from empirical measurements of the crossover point
   // between the average error of the linear estimator and the adjusted hll estimator
   double crossOver = 0.64;
-  if (this->lgConfigK == 4)      { crossOver = 0.718; }
-  else if (this->lgConfigK == 5) { crossOver = 0.672; }
+  if (lgConfigK == 4)      { crossOver = 0.718; }
+  else if (lgConfigK == 5) { crossOver = 0.672; }
 
-  return (avgEst > (crossOver * (1 << this->lgConfigK))) ? adjEst : linEst;
+  return (avgEst > (crossOver * (1 << lgConfigK))) ? adjEst : linEst;
 }
 
 template<typename A>
@@ -622,7 +654,7 @@ void HllArray<A>::hipAndKxQIncrementalUpdate(HllArray<A>& host, const int oldVal
  */
 //In C: again-two-registers.c hhb_get_improved_linear_counting_estimate L1274
 template<typename A>
-double HllArray<A>::getHllBitMapEstimate(const int lgConfigK, const int curMin, const int numAtCurMin) const {
+double HllArray<A>::getHllBitMapEstimate(const int lgConfigK, const int curMin, const int numAtCurMin) {
   const  int configK = 1 << lgConfigK;
   const  int numUnhitBuckets =  ((curMin == 0) ? numAtCurMin : 0);
 
@@ -637,7 +669,7 @@ double HllArray<A>::getHllBitMapEstimate(const int lgConfigK, const int curMin,
 
 //In C: again-two-registers.c hhb_get_raw_estimate L1167
 template<typename A>
-double HllArray<A>::getHllRawEstimate(const int lgConfigK, const double kxqSum) const {
+double HllArray<A>::getHllRawEstimate(const int lgConfigK, const double kxqSum) {
   const int configK = 1 << lgConfigK;
   double correctionFactor;
   if (lgConfigK == 4) { correctionFactor = 0.673; }
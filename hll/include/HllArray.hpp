@@ -29,6 +29,9 @@ namespace datasketches {
 template<typename A>
 class AuxHashMap;
 
+template<typename A>
+class Hll8Array;
+
 template<typename A = std::allocator<char>>
 class HllArray : public HllSketchImpl<A> {
   public:
@@ -91,18 +94,27 @@ class HllArray : public HllSketchImpl<A> {
     void putKxQ1(double kxq1);
     void putNumAtCurMin(int numAtCurMin);
 
+    // stores the composite estimate for the current state, so that const queries can reuse it
+    void refreshCompositeEstimate();
+
     static int hllArrBytes(target_hll_type tgtHllType, int lgConfigK);
     static int hll4ArrBytes(int lgConfigK);
     static int hll6ArrBytes(int lgConfigK);
     static int hll8ArrBytes(int lgConfigK);
 
+    // estimators as functions of the preamble fields, shared with the wrapped (serialized) view
+    static double computeCompositeEstimate(int lgConfigK, double kxqSum, int curMin, int numAtCurMin);
+    static double computeLowerBound(int lgConfigK, bool oooFlag, double estimate,
+                                    int curMin, int numAtCurMin, int numStdDev);
+    static double computeUpperBound(int lgConfigK, bool oooFlag, double estimate, int numStdDev);
+
     virtual AuxHashMap<A>* getAuxHashMap() const;
 
   protected:
     // TODO: does this need to be static?
     static void hipAndKxQIncrementalUpdate(HllArray& host, int oldValue, int newValue);
-    double getHllBitMapEstimate(int lgConfigK, int curMin, int numAtCurMin) const;
-    double getHllRawEstimate(int lgConfigK, double kxqSum) const;
+    static double getHllBitMapEstimate(int lgConfigK, int curMin, int numAtCurMin);
+    static double getHllRawEstimate(int lgConfigK, double kxqSum);
 
     double hipAccum;
     double kxq0;
@@ -112,7 +124,16 @@ class HllArray : public HllSketchImpl<A> {
     int numAtCurMin; //interpreted as num zeros when curMin == 0
     bool oooFlag; //Out-Of-Order Flag
 
+    // The composite estimate only depends on kxq0 + kxq1, curMin and numAtCurMin.
+    // It is stored with those values by refreshCompositeEstimate() on write paths,
+    // and used by getCompositeEstimate() only while they still match.
+    double cachedKxQSum; // NaN when nothing is cached
+    int cachedCurMin;
+    int cachedNumAtCurMin;
+    double cachedCompositeEstimate;
+
     friend class HllSketchImplFactory<A>;
+    friend class Hll8Array<A>;
 };
 
 }
@@ -0,0 +1,184 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+#ifndef _HLLCONCURRENTSKETCH_INTERNAL_HPP_
+#define _HLLCONCURRENTSKETCH_INTERNAL_HPP_
+
+#include "hll_concurrent_sketch.hpp"
+
+namespace datasketches {
+
+template<typename A>
+concurrent_hll_sketch_alloc<A>::concurrent_hll_sketch_alloc(int lg_config_k) :
+  lg_config_k(HllUtil<A>::checkLgK(lg_config_k)),
+  registers(1 << (lg_config_k - 2)),
+  is_dirty(false),
+  has_registers(false),
+  cached_estimate(0),
+  cached_lower_bounds(),
+  cached_upper_bounds()
+{
+  for (auto& word: registers) word.store(0, std::memory_order_relaxed);
+}
+
+template<typename A>
+void concurrent_hll_sketch_alloc<A>::update(const std::string& datum) {
+  coupon_update(hll_sketch_alloc<A>::get_coupon(datum));
+}
+
+template<typename A>
+void concurrent_hll_sketch_alloc<A>::update(const uint64_t datum) {
+  coupon_update(hll_sketch_alloc<A>::get_coupon(datum));
+}
+
+template<typename A>
+void concurrent_hll_sketch_alloc<A>::update(const uint32_t datum) {
+  coupon_update(hll_sketch_alloc<A>::get_coupon(datum));
+}
+
+template<typename A>
+void concurrent_hll_sketch_alloc<A>::update(const uint16_t datum) {
+  coupon_update(hll_sketch_alloc<A>::get_coupon(datum));
+}
+
+template<typename A>
+void concurrent_hll_sketch_alloc<A>::update(const uint8_t datum) {
+  coupon_update(hll_sketch_alloc<A>::get_coupon(datum));
+}
+
+template<typename A>
+void concurrent_hll_sketch_alloc<A>::update(const int64_t datum) {
+  coupon_update(hll_sketch_alloc<A>::get_coupon(datum));
+}
+
+template<typename A>
+void concurrent_hll_sketch_alloc<A>::update(const int32_t datum) {
+  coupon_update(hll_sketch_alloc<A>::get_coupon(datum));
+}
+
+template<typename A>
+void concurrent_hll_sketch_alloc<A>::update(const int16_t datum) {
+  coupon_update(hll_sketch_alloc<A>::get_coupon(datum));
+}
+
+template<typename A>
+void concurrent_hll_sketch_alloc<A>::update(const int8_t datum) {
+  coupon_update(hll_sketch_alloc<A>::get_coupon(datum));
+}
+
+template<typename A>
+void concurrent_hll_sketch_alloc<A>::update(const double datum) {
+  coupon_update(hll_sketch_alloc<A>::get_coupon(datum));
+}
+
+template<typename A>
+void concurrent_hll_sketch_alloc<A>::update(const float datum) {
+  coupon_update(hll_sketch_alloc<A>::get_coupon(datum));
+}
+
+template<typename A>
+void concurrent_hll_sketch_alloc<A>::update(const void* data, const size_t length_bytes) {
+  coupon_update(hll_sketch_alloc<A>::get_coupon(data, length_bytes));
+}
+
+template<typename A>
+void concurrent_hll_sketch_alloc<A>::coupon_update(const int coupon) {
+  if (coupon == HllUtil<A>::EMPTY) { return; }
+  const int slotNo = HllUtil<A>::getLow26(coupon) & ((1 << lg_config_k) - 1);
+  const uint32_t newVal = HllUtil<A>::getValue(coupon);
+  std::atomic<uint32_t>& word = registers[slotNo >> 2];
+  const int shift = (slotNo & 3) << 3;
+  uint32_t curWord = word.load(std::memory_order_relaxed);
+  // atomic byte max: retry until the register is at least newVal, one way or another
+  while (((curWord >> shift) & 0xff) < newVal) {
+    const uint32_t newWord = (curWord & ~(0xffU << shift)) | (newVal << shift);
+    // sequentially consistent with the flag check, so that a refresh clearing the flag
+    // after it was seen set also sees this change
+    if (word.compare_exchange_weak(curWord, newWord, std::memory_order_seq_cst, std::memory_order_relaxed)) {
+      if (!has_registers.load(std::memory_order_relaxed)) has_registers.store(true, std::memory_order_release);
+      if (!is_dirty.load(std::memory_order_seq_cst)) is_dirty.store(true, std::memory_order_seq_cst);
+      return;
+    }
+  }
+}
+
+template<typename A>
+hll_sketch_alloc<A> concurrent_hll_sketch_alloc<A>::get_result() const {
+  hll_sketch_alloc<A> sketch(lg_config_k, HLL_8, true);
+  Hll8Array<A>* hllArray = static_cast<Hll8Array<A>*>(sketch.sketch_impl);
+  for (size_t i = 0; i < registers.size(); i++) {
+    const uint32_t word = registers[i].load(std::memory_order_relaxed);
+    for (int j = 0; j < 4; j++) {
+      hllArray->hllByteArr[(i << 2) + j] = (word >> (j << 3)) & 0xff;
+    }
+  }
+  hllArray->rebuildKxQNumZeros();
+  hllArray->putOutOfOrderFlag(true);
+  hllArray->refreshCompositeEstimate();
+  return sketch;
+}
+
+template<typename A>
+void concurrent_hll_sketch_alloc<A>::refresh_cache() const {
+  if (!is_dirty.exchange(false, std::memory_order_seq_cst)) return;
+  std::atomic_thread_fence(std::memory_order_seq_cst); // the snapshot below sees every change that found the flag set
+  const hll_sketch_alloc<A> sketch = get_result();
+  cached_estimate = sketch.get_estimate();
+  for (int i = 0; i < 3; i++) {
+    cached_lower_bounds[i] = sketch.get_lower_bound(i + 1);
+    cached_upper_bounds[i] = sketch.get_upper_bound(i + 1);
+  }
+}
+
+template<typename A>
+double concurrent_hll_sketch_alloc<A>::get_estimate() const {
+  std::lock_guard<std::mutex> lock(cache_mutex);
+  refresh_cache();
+  return cached_estimate;
+}
+
+template<typename A>
+double concurrent_hll_sketch_alloc<A>::get_lower_bound(const int num_std_dev) const {
+  HllUtil<A>::checkNumStdDev(num_std_dev);
+  std::lock_guard<std::mutex> lock(cache_mutex);
+  refresh_cache();
+  return cached_lower_bounds[num_std_dev - 1];
+}
+
+template<typename A>
+double concurrent_hll_sketch_alloc<A>::get_upper_bound(const int num_std_dev) const {
+  HllUtil<A>::checkNumStdDev(num_std_dev);
+  std::lock_guard<std::mutex> lock(cache_mutex);
+  refresh_cache();
+  return cached_upper_bounds[num_std_dev - 1];
+}
+
+template<typename A>
+int concurrent_hll_sketch_alloc<A>::get_lg_config_k() const {
+  return lg_config_k;
+}
+
+template<typename A>
+bool concurrent_hll_sketch_alloc<A>::is_empty() const {
+  return !has_registers.load(std::memory_order_acquire);
+}
+
+}
+
+#endif // _HLLCONCURRENTSKETCH_INTERNAL_HPP_
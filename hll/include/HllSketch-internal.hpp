@@ -26,6 +26,7 @@
 #include "CouponList.hpp"
 #include "HllArray.hpp"
 
+#include <algorithm>
 #include <cstdio>
 #include <cstdlib>
 #include <string>
@@ -120,100 +121,220 @@ void hll_sketch_alloc<A>::reset() {
 
 template<typename A>
 void hll_sketch_alloc<A>::update(const std::string& datum) {
-  if (datum.empty()) { return; }
-  HashState hashResult;
-  HllUtil<A>::hash(datum.c_str(), datum.length(), HllUtil<A>::DEFAULT_UPDATE_SEED, hashResult);
-  coupon_update(HllUtil<A>::coupon(hashResult));
+  coupon_update(get_coupon(datum));
 }
 
 template<typename A>
 void hll_sketch_alloc<A>::update(const uint64_t datum) {
-  // no sign extension with 64 bits so no need to cast to signed value
-  HashState hashResult;
-  HllUtil<A>::hash(&datum, sizeof(uint64_t), HllUtil<A>::DEFAULT_UPDATE_SEED, hashResult);
-  coupon_update(HllUtil<A>::coupon(hashResult));
+  coupon_update(get_coupon(datum));
 }
 
 template<typename A>
 void hll_sketch_alloc<A>::update(const uint32_t datum) {
-  update(static_cast<int32_t>(datum));
+  coupon_update(get_coupon(datum));
 }
 
 template<typename A>
 void hll_sketch_alloc<A>::update(const uint16_t datum) {
-  update(static_cast<int16_t>(datum));
+  coupon_update(get_coupon(datum));
 }
 
 template<typename A>
 void hll_sketch_alloc<A>::update(const uint8_t datum) {
-  update(static_cast<int8_t>(datum));
+  coupon_update(get_coupon(datum));
 }
 
 template<typename A>
 void hll_sketch_alloc<A>::update(const int64_t datum) {
-  HashState hashResult;
-  HllUtil<A>::hash(&datum, sizeof(int64_t), HllUtil<A>::DEFAULT_UPDATE_SEED, hashResult);
-  coupon_update(HllUtil<A>::coupon(hashResult));
+  coupon_update(get_coupon(datum));
 }
 
 template<typename A>
 void hll_sketch_alloc<A>::update(const int32_t datum) {
-  int64_t val = static_cast<int64_t>(datum);
-  HashState hashResult;
-  HllUtil<A>::hash(&val, sizeof(int64_t), HllUtil<A>::DEFAULT_UPDATE_SEED, hashResult);
-  coupon_update(HllUtil<A>::coupon(hashResult));
+  coupon_update(get_coupon(datum));
 }
 
 template<typename A>
 void hll_sketch_alloc<A>::update(const int16_t datum) {
-  int64_t val = static_cast<int64_t>(datum);
-  HashState hashResult;
-  HllUtil<A>::hash(&val, sizeof(int64_t), HllUtil<A>::DEFAULT_UPDATE_SEED, hashResult);
-  coupon_update(HllUtil<A>::coupon(hashResult));
+  coupon_update(get_coupon(datum));
 }
 
 template<typename A>
 void hll_sketch_alloc<A>::update(const int8_t datum) {
-  int64_t val = static_cast<int64_t>(datum);
-  HashState hashResult;
-  HllUtil<A>::hash(&val, sizeof(int64_t), HllUtil<A>::DEFAULT_UPDATE_SEED, hashResult);
-  coupon_update(HllUtil<A>::coupon(hashResult));
+  coupon_update(get_coupon(datum));
 }
 
 template<typename A>
 void hll_sketch_alloc<A>::update(const double datum) {
-  longDoubleUnion d;
-  d.doubleBytes = static_cast<double>(datum);
-  if (datum == 0.0) {
-    d.doubleBytes = 0.0; // canonicalize -0.0 to 0.0
-  } else if (std::isnan(d.doubleBytes)) {
-    d.longBytes = 0x7ff8000000000000L; // canonicalize NaN using value from Java's Double.doubleToLongBits()
-  }
-  HashState hashResult;
-  HllUtil<A>::hash(&d, sizeof(double), HllUtil<A>::DEFAULT_UPDATE_SEED, hashResult);
-  coupon_update(HllUtil<A>::coupon(hashResult));
+  coupon_update(get_coupon(datum));
 }
 
 template<typename A>
 void hll_sketch_alloc<A>::update(const float datum) {
+  coupon_update(get_coupon(datum));
+}
+
+template<typename A>
+void hll_sketch_alloc<A>::update(const void* data, const size_t lengthBytes) {
+  coupon_update(get_coupon(data, lengthBytes));
+}
+
+template<typename A>
+int hll_sketch_alloc<A>::get_coupon(const std::string& datum) {
+  if (datum.empty()) { return HllUtil<A>::EMPTY; }
+  return get_coupon(datum.c_str(), datum.length());
+}
+
+template<typename A>
+int hll_sketch_alloc<A>::get_coupon(const uint64_t datum) {
+  // no sign extension with 64 bits so no need to cast to signed value
+  return get_coupon(&datum, sizeof(uint64_t));
+}
+
+template<typename A>
+int hll_sketch_alloc<A>::get_coupon(const uint32_t datum) {
+  return get_coupon(static_cast<int32_t>(datum));
+}
+
+template<typename A>
+int hll_sketch_alloc<A>::get_coupon(const uint16_t datum) {
+  return get_coupon(static_cast<int16_t>(datum));
+}
+
+template<typename A>
+int hll_sketch_alloc<A>::get_coupon(const uint8_t datum) {
+  return get_coupon(static_cast<int8_t>(datum));
+}
+
+template<typename A>
+int hll_sketch_alloc<A>::get_coupon(const int64_t datum) {
+  return get_coupon(&datum, sizeof(int64_t));
+}
+
+template<typename A>
+int hll_sketch_alloc<A>::get_coupon(const int32_t datum) {
+  return get_coupon(static_cast<int64_t>(datum));
+}
+
+template<typename A>
+int hll_sketch_alloc<A>::get_coupon(const int16_t datum) {
+  return get_coupon(static_cast<int64_t>(datum));
+}
+
+template<typename A>
+int hll_sketch_alloc<A>::get_coupon(const int8_t datum) {
+  return get_coupon(static_cast<int64_t>(datum));
+}
+
+template<typename A>
+int hll_sketch_alloc<A>::get_coupon(const double datum) {
   longDoubleUnion d;
-  d.doubleBytes = static_cast<double>(datum);
+  d.doubleBytes = datum;
   if (datum == 0.0) {
     d.doubleBytes = 0.0; // canonicalize -0.0 to 0.0
   } else if (std::isnan(d.doubleBytes)) {
     d.longBytes = 0x7ff8000000000000L; // canonicalize NaN using value from Java's Double.doubleToLongBits()
   }
-  HashState hashResult;
-  HllUtil<A>::hash(&d, sizeof(double), HllUtil<A>::DEFAULT_UPDATE_SEED, hashResult);
-  coupon_update(HllUtil<A>::coupon(hashResult));
+  return get_coupon(&d, sizeof(double));
 }
 
 template<typename A>
-void hll_sketch_alloc<A>::update(const void* data, const size_t lengthBytes) {
-  if (data == nullptr) { return; }
+int hll_sketch_alloc<A>::get_coupon(const float datum) {
+  return get_coupon(static_cast<double>(datum));
+}
+
+template<typename A>
+int hll_sketch_alloc<A>::get_coupon(const void* data, const size_t lengthBytes) {
+  if (data == nullptr) { return HllUtil<A>::EMPTY; }
   HashState hashResult;
   HllUtil<A>::hash(data, lengthBytes, HllUtil<A>::DEFAULT_UPDATE_SEED, hashResult);
-  coupon_update(HllUtil<A>::coupon(hashResult));
+  return HllUtil<A>::coupon(hashResult);
+}
+
+template<typename A>
+void hll_sketch_alloc<A>::update_hashed(const uint64_t h0, const uint64_t h1, const uint64_t seed) {
+  if (seed != HllUtil<A>::DEFAULT_UPDATE_SEED) {
+    throw std::invalid_argument("Seed mismatch: HLL sketches use seed " + std::to_string(HllUtil<A>::DEFAULT_UPDATE_SEED));
+  }
+  const uint64_t hash[2] = {h0, h1};
+  coupon_update(HllUtil<A>::coupon(hash));
+}
+
+template<typename A>
+void hll_sketch_alloc<A>::update_batch(const uint64_t* values, size_t num) {
+  int coupons[BATCH_SIZE];
+  while (num > 0) {
+    const unsigned batch_size = std::min(num, static_cast<size_t>(BATCH_SIZE));
+    for (unsigned i = 0; i < batch_size; i++) coupons[i] = get_coupon(values[i]);
+    coupon_update(coupons, batch_size);
+    values += batch_size;
+    num -= batch_size;
+  }
+}
+
+template<typename A>
+void hll_sketch_alloc<A>::update_batch(const int64_t* values, size_t num) {
+  update_batch(reinterpret_cast<const uint64_t*>(values), num);
+}
+
+template<typename A>
+void hll_sketch_alloc<A>::update_batch(const std::string* values, size_t num) {
+  int coupons[BATCH_SIZE];
+  while (num > 0) {
+    const unsigned batch_size = std::min(num, static_cast<size_t>(BATCH_SIZE));
+    unsigned num_coupons = 0;
+    for (unsigned i = 0; i < batch_size; i++) {
+      if (!values[i].empty()) coupons[num_coupons++] = get_coupon(values[i]);
+    }
+    coupon_update(coupons, num_coupons);
+    values += batch_size;
+    num -= batch_size;
+  }
+}
+
+template<typename A>
+void hll_sketch_alloc<A>::update_batch(const char* data, const uint32_t* offsets, size_t num) {
+  int coupons[BATCH_SIZE];
+  while (num > 0) {
+    const unsigned batch_size = std::min(num, static_cast<size_t>(BATCH_SIZE));
+    unsigned num_coupons = 0;
+    for (unsigned i = 0; i < batch_size; i++) {
+      const uint32_t length = offsets[i + 1] - offsets[i];
+      if (length > 0) coupons[num_coupons++] = get_coupon(data + offsets[i], length);
+    }
+    coupon_update(coupons, num_coupons);
+    offsets += batch_size;
+    num -= batch_size;
+  }
+}
+
+template<typename A>
+void hll_sketch_alloc<A>::coupon_update(const int* coupons, unsigned num) {
+  // coupons are applied in order since the HIP accumulator depends on the order of updates
+  // the mode only goes from list to set to HLL, so the HLL array type is dispatched once
+  unsigned i = 0;
+  while (i < num && sketch_impl->getCurMode() != HLL) coupon_update(coupons[i++]);
+  if (i == num) return;
+  switch (sketch_impl->getTgtHllType()) {
+    case HLL_4:
+      array_coupon_update(static_cast<Hll4Array<A>*>(sketch_impl), coupons + i, num - i);
+      break;
+    case HLL_6:
+      array_coupon_update(static_cast<Hll6Array<A>*>(sketch_impl), coupons + i, num - i);
+      break;
+    case HLL_8:
+      array_coupon_update(static_cast<Hll8Array<A>*>(sketch_impl), coupons + i, num - i);
+      break;
+  }
+}
+
+template<typename A>
+template<typename HllArrayType>
+void hll_sketch_alloc<A>::array_coupon_update(HllArrayType* array, const int* coupons, unsigned num) {
+  // HLL arrays never change mode, so the result of couponUpdate is always the same array
+  for (unsigned i = 0; i < num; i++) {
+    if (coupons[i] != HllUtil<A>::EMPTY) array->couponUpdate(coupons[i]);
+  }
 }
 
 template<typename A>
@@ -81,6 +81,8 @@ class HllSketchImpl {
     const target_hll_type tgtHllType;
     const hll_mode mode;
     const bool startFullSize;
+
+    friend class wrapped_hll_sketch_alloc<A>;
 };
 
 }
@@ -80,6 +80,104 @@ void hll_union_alloc<A>::update(const hll_sketch_alloc<A>& sketch) {
   union_impl(static_cast<const hll_sketch_alloc<A>&>(sketch).sketch_impl, lg_max_k);
 }
 
+template<typename A>
+void hll_union_alloc<A>::update(const wrapped_hll_sketch_alloc<A>& sketch) {
+  if (sketch.is_empty()) {
+    return;
+  }
+  HllSketchImpl<A>* dstImpl = gadget.sketch_impl;
+  const bool gadget_empty = dstImpl->isEmpty();
+  const hll_mode gadget_mode = dstImpl->getCurMode();
+
+  if (sketch.mode != HLL) {
+    // coupons in serialized order, the same as the array order of a deserialized sketch
+    if (!gadget_empty && (gadget_mode == HLL)) {
+      Hll8Array<A>* dst = static_cast<Hll8Array<A>*>(dstImpl);
+      for (int i = 0; i < sketch.num_coupon_ints; i++) {
+        const int coupon = sketch.get_coupon(i);
+        if (coupon != HllUtil<A>::EMPTY) dst->couponUpdate(coupon);
+      }
+    } else {
+      for (int i = 0; i < sketch.num_coupon_ints; i++) {
+        const int coupon = sketch.get_coupon(i);
+        if (coupon != HllUtil<A>::EMPTY) dstImpl = leak_free_coupon_update(dstImpl, coupon);
+      }
+    }
+    // same outcome as the LIST and SET source cases of union_impl
+    if ((sketch.mode == SET) || (!gadget_empty && (gadget_mode == SET))) {
+      dstImpl->putOutOfOrderFlag(true); //SET oooFlag is always true
+    } else if (gadget_empty) {
+      dstImpl->putOutOfOrderFlag(sketch.out_of_order); //whatever source is
+    } else {
+      dstImpl->putOutOfOrderFlag(dstImpl->isOutOfOrderFlag() | sketch.out_of_order);
+    }
+  } else if (gadget_empty) {
+    dstImpl = copy_or_downsample(sketch, lg_max_k);
+    dstImpl->putOutOfOrderFlag(sketch.out_of_order); //whatever source is
+    gadget.sketch_impl->get_deleter()(gadget.sketch_impl);
+  } else if (gadget_mode != HLL) {
+    // swap so that the source is the gadget LIST or SET, and the target is the copied HLL
+    HllSketchImpl<A>* src_impl = gadget.sketch_impl;
+    dstImpl = copy_or_downsample(sketch, lg_max_k);
+    merge_coupons(static_cast<Hll8Array<A>*>(dstImpl), static_cast<CouponList<A>*>(src_impl));
+    dstImpl->putOutOfOrderFlag((gadget_mode == SET) | src_impl->isOutOfOrderFlag() | dstImpl->isOutOfOrderFlag());
+    src_impl->get_deleter()(src_impl);
+  } else {
+    if ((sketch.lg_config_k < dstImpl->getLgConfigK()) || (dstImpl->getTgtHllType() != HLL_8)) {
+      dstImpl = copy_or_downsample(dstImpl, sketch.lg_config_k);
+      gadget.sketch_impl->get_deleter()(gadget.sketch_impl);
+    }
+    sketch.merge_registers(*static_cast<Hll8Array<A>*>(dstImpl));
+    dstImpl->putOutOfOrderFlag(true); //union of two HLL modes is always true
+  }
+  gadget.sketch_impl = dstImpl;
+  refresh_gadget_estimate();
+}
+
+template<typename A>
+void hll_union_alloc<A>::refresh_gadget_estimate() {
+  HllSketchImpl<A>* impl = gadget.sketch_impl;
+  if ((impl->getCurMode() == HLL) && impl->isOutOfOrderFlag()) {
+    static_cast<HllArray<A>*>(impl)->refreshCompositeEstimate();
+  }
+}
+
+template<typename A>
+void hll_union_alloc<A>::update_from_bytes(const void* bytes, size_t len) {
+  update(wrapped_hll_sketch_alloc<A>::wrap(bytes, len));
+}
+
+template<typename A>
+void hll_union_alloc<A>::update_from_bytes(std::istream& is) {
+  vector_u8<A> buffer;
+  while (is.peek() != std::istream::traits_type::eof()) {
+    // fixed part of the preamble, then the rest of it which gives the size of the image
+    buffer.resize(HllUtil<A>::EMPTY_SKETCH_SIZE_BYTES);
+    read_bytes(is, buffer.data(), buffer.size());
+    const int preInts = buffer[HllUtil<A>::PREAMBLE_INTS_BYTE];
+    if ((preInts != HllUtil<A>::LIST_PREINTS) && (preInts != HllUtil<A>::HASH_SET_PREINTS)
+        && (preInts != HllUtil<A>::HLL_PREINTS)) {
+      throw std::invalid_argument("Attempt to deserialize unknown object type");
+    }
+    const size_t preambleBytes = preInts * sizeof(int);
+    buffer.resize(preambleBytes);
+    read_bytes(is, buffer.data() + HllUtil<A>::EMPTY_SKETCH_SIZE_BYTES,
+               preambleBytes - HllUtil<A>::EMPTY_SKETCH_SIZE_BYTES);
+    const size_t sketchBytes = wrapped_hll_sketch_alloc<A>::get_serialized_size_bytes(buffer.data());
+    buffer.resize(sketchBytes);
+    read_bytes(is, buffer.data() + preambleBytes, sketchBytes - preambleBytes);
+    update(wrapped_hll_sketch_alloc<A>::wrap(buffer.data(), buffer.size()));
+  }
+}
+
+template<typename A>
+void hll_union_alloc<A>::read_bytes(std::istream& is, uint8_t* dst, size_t len) {
+  is.read(reinterpret_cast<char*>(dst), len);
+  if (static_cast<size_t>(is.gcount()) != len) {
+    throw std::invalid_argument("Input stream ended in the middle of a sketch");
+  }
+}
+
 template<typename A>
 void hll_union_alloc<A>::update(const std::string& datum) {
   gadget.update(datum);
@@ -279,11 +377,8 @@ HllSketchImpl<A>* hll_union_alloc<A>::copy_or_downsample(HllSketchImpl<A>* src_i
     return src->copy();
   }
   const int minLgK = ((src_lg_k < tgt_lg_k) ? src_lg_k : tgt_lg_k);
-  HllArray<A>* tgtHllArr = HllSketchImplFactory<A>::newHll(minLgK, target_hll_type::HLL_8);
-  pair_iterator_with_deleter<A> srcItr = src->getIterator();
-  while (srcItr->nextValid()) {
-    tgtHllArr->couponUpdate(srcItr->getPair());
-  }
+  Hll8Array<A>* tgtHllArr = static_cast<Hll8Array<A>*>(HllSketchImplFactory<A>::newHll(minLgK, target_hll_type::HLL_8));
+  tgtHllArr->mergeHll(*src);
   //both of these are required for isomorphism
   tgtHllArr->putHipAccum(src->getHipAccum());
   tgtHllArr->putOutOfOrderFlag(src->isOutOfOrderFlag());
@@ -291,6 +386,17 @@ HllSketchImpl<A>* hll_union_alloc<A>::copy_or_downsample(HllSketchImpl<A>* src_i
   return tgtHllArr;
 }
 
+template<typename A>
+HllSketchImpl<A>* hll_union_alloc<A>::copy_or_downsample(const wrapped_hll_sketch_alloc<A>& src, const int tgt_lg_k) {
+  const int minLgK = ((src.lg_config_k < tgt_lg_k) ? src.lg_config_k : tgt_lg_k);
+  Hll8Array<A>* tgtHllArr = static_cast<Hll8Array<A>*>(HllSketchImplFactory<A>::newHll(minLgK, target_hll_type::HLL_8));
+  src.merge_registers(*tgtHllArr);
+  //both of these are required for isomorphism
+  tgtHllArr->putHipAccum(src.hip_accum);
+  tgtHllArr->putOutOfOrderFlag(src.out_of_order);
+  return tgtHllArr;
+}
+
 template<typename A>
 inline HllSketchImpl<A>* hll_union_alloc<A>::leak_free_coupon_update(HllSketchImpl<A>* impl, const int coupon) {
   HllSketchImpl<A>* result = impl->couponUpdate(coupon);
@@ -300,6 +406,16 @@ inline HllSketchImpl<A>* hll_union_alloc<A>::leak_free_coupon_update(HllSketchIm
   return result;
 }
 
+template<typename A>
+void hll_union_alloc<A>::merge_coupons(Hll8Array<A>* dst, const CouponList<A>* src) {
+  // same order as the pair iterator, so the HIP accumulator gets the same updates
+  const int* coupons = src->getCouponIntArr();
+  const int len = 1 << src->getLgCouponArrInts();
+  for (int i = 0; i < len; i++) {
+    if (coupons[i] != HllUtil<A>::EMPTY) dst->couponUpdate(coupons[i]);
+  }
+}
+
 template<typename A>
 void hll_union_alloc<A>::union_impl(HllSketchImpl<A>* incoming_impl, const int lg_max_k) {
   if (gadget.sketch_impl->getTgtHllType() != target_hll_type::HLL_8) {
@@ -341,10 +457,7 @@ void hll_union_alloc<A>::union_impl(HllSketchImpl<A>* incoming_impl, const int l
       //use lg_max_k because LIST has effective K of 2^26
       src_impl = gadget.sketch_impl;
       dstImpl = copy_or_downsample(incoming_impl, lg_max_k);
-      pair_iterator_with_deleter<A> srcItr = src_impl->getIterator();
-      while (srcItr->nextValid()) {
-        dstImpl = leak_free_coupon_update(dstImpl, srcItr->getPair()); //assignment required
-      }
+      merge_coupons(static_cast<Hll8Array<A>*>(dstImpl), static_cast<CouponList<A>*>(src_impl));
       //whichever is True wins:
       dstImpl->putOutOfOrderFlag(src_impl->isOutOfOrderFlag() | dstImpl->isOutOfOrderFlag());
       // gadget: swapped, replacing with new impl
@@ -374,13 +487,10 @@ void hll_union_alloc<A>::union_impl(HllSketchImpl<A>* incoming_impl, const int l
       //use lg_max_k because LIST has effective K of 2^26
       src_impl = gadget.sketch_impl;
       dstImpl = copy_or_downsample(incoming_impl, lg_max_k);
-      pair_iterator_with_deleter<A> srcItr = src_impl->getIterator(); //LIST
       if (dstImpl->getCurMode() != HLL) {
         throw std::logic_error("dstImpl must be in HLL mode");
       }
-      while (srcItr->nextValid()) {
-        dstImpl = leak_free_coupon_update(dstImpl, srcItr->getPair()); //assignment required
-      }
+      merge_coupons(static_cast<Hll8Array<A>*>(dstImpl), static_cast<CouponList<A>*>(src_impl));
       dstImpl->putOutOfOrderFlag(true); //merging SET into non-empty HLL -> true
       // gadget: swapped, replacing with new impl
       gadget.sketch_impl->get_deleter()(gadget.sketch_impl);
@@ -390,10 +500,7 @@ void hll_union_alloc<A>::union_impl(HllSketchImpl<A>* incoming_impl, const int l
       if (dstImpl->getCurMode() != HLL) {
         throw std::logic_error("dstImpl must be in HLL mode");
       }
-      pair_iterator_with_deleter<A> srcItr = src_impl->getIterator(); //LIST
-      while (srcItr->nextValid()) {
-        dstImpl = leak_free_coupon_update(dstImpl, srcItr->getPair()); //assignment required
-      }
+      merge_coupons(static_cast<Hll8Array<A>*>(dstImpl), static_cast<CouponList<A>*>(src_impl));
       //whichever is True wins:
       dstImpl->putOutOfOrderFlag(dstImpl->isOutOfOrderFlag() | src_impl->isOutOfOrderFlag());
       // gadget: should remain unchanged
@@ -407,10 +514,7 @@ void hll_union_alloc<A>::union_impl(HllSketchImpl<A>* incoming_impl, const int l
       if (dstImpl->getCurMode() != HLL) {
         throw std::logic_error("dstImpl must be in HLL mode");
       }
-      pair_iterator_with_deleter<A> srcItr = src_impl->getIterator(); //SET
-      while (srcItr->nextValid()) {
-        dstImpl = leak_free_coupon_update(dstImpl, srcItr->getPair()); //assignment required
-      }
+      merge_coupons(static_cast<Hll8Array<A>*>(dstImpl), static_cast<CouponList<A>*>(src_impl));
       dstImpl->putOutOfOrderFlag(true); //merging SET into existing HLL -> true
       // gadget: should remain unchanged
       if (dstImpl != gadget.sketch_impl) {
@@ -428,10 +532,8 @@ void hll_union_alloc<A>::union_impl(HllSketchImpl<A>* incoming_impl, const int l
         // always replaces gadget
         gadget.sketch_impl->get_deleter()(gadget.sketch_impl);
       }
-      pair_iterator_with_deleter<A> srcItr = src_impl->getIterator(); //HLL
-      while (srcItr->nextValid()) {
-        dstImpl = leak_free_coupon_update(dstImpl, srcItr->getPair()); //assignment required
-      }
+      // register-wise max, the HIP accumulator is not used after this since the result is out of order
+      static_cast<Hll8Array<A>*>(dstImpl)->mergeHll(*static_cast<HllArray<A>*>(src_impl));
       dstImpl->putOutOfOrderFlag(true); //union of two HLL modes is always true
       // gadget: replaced if copied/downampled, otherwise should be unchanged
       break;
@@ -464,6 +566,7 @@ void hll_union_alloc<A>::union_impl(HllSketchImpl<A>* incoming_impl, const int l
   }
   
   gadget.sketch_impl = dstImpl;
+  refresh_gadget_estimate();
 }
 
 }
@@ -0,0 +1,254 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+
+#ifndef _HLLWRAPPEDSKETCH_INTERNAL_HPP_
+#define _HLLWRAPPEDSKETCH_INTERNAL_HPP_
+
+#include "hll.hpp"
+#include "HllUtil.hpp"
+#include "HllSketchImpl.hpp"
+#include "HllArray.hpp"
+#include "Hll8Array.hpp"
+#include "CubicInterpolation.hpp"
+
+#include <cstring>
+#include <stdexcept>
+#include <string>
+
+namespace datasketches {
+
+template<typename A>
+wrapped_hll_sketch_alloc<A>::wrapped_hll_sketch_alloc(const uint8_t* data, hll_mode mode,
+                                                      target_hll_type tgt_type, int lg_config_k,
+                                                      bool compact, bool out_of_order) :
+data(data),
+mode(mode),
+tgt_type(tgt_type),
+lg_config_k(lg_config_k),
+compact(compact),
+out_of_order(out_of_order),
+coupon_count(0),
+num_coupon_ints(0),
+cur_min(0),
+num_at_cur_min(1 << lg_config_k),
+num_aux_ints(0),
+hip_accum(0),
+kxq0(1 << lg_config_k),
+kxq1(0)
+{}
+
+template<typename A>
+const wrapped_hll_sketch_alloc<A> wrapped_hll_sketch_alloc<A>::wrap(const void* bytes, size_t len) {
+  if (len < static_cast<size_t>(HllUtil<A>::EMPTY_SKETCH_SIZE_BYTES)) {
+    throw std::invalid_argument("Input data length insufficient to hold an HLL sketch");
+  }
+  const uint8_t* data = static_cast<const uint8_t*>(bytes);
+  if (data[HllUtil<A>::SER_VER_BYTE] != HllUtil<A>::SER_VER) {
+    throw std::invalid_argument("Wrong ser ver in input array");
+  }
+  if (data[HllUtil<A>::FAMILY_BYTE] != HllUtil<A>::FAMILY_ID) {
+    throw std::invalid_argument("Input array is not an HLL sketch");
+  }
+
+  const hll_mode mode = HllSketchImpl<A>::extractCurMode(data[HllUtil<A>::MODE_BYTE]);
+  const int preInts = data[HllUtil<A>::PREAMBLE_INTS_BYTE];
+  if ((mode == LIST && preInts != HllUtil<A>::LIST_PREINTS)
+      || (mode == SET && preInts != HllUtil<A>::HASH_SET_PREINTS)
+      || (mode == HLL && preInts != HllUtil<A>::HLL_PREINTS)) {
+    throw std::invalid_argument("Incorrect number of preInts in input array");
+  }
+
+  const target_hll_type tgtHllType = HllSketchImpl<A>::extractTgtHllType(data[HllUtil<A>::MODE_BYTE]);
+  const int lgK = HllUtil<A>::checkLgK(data[HllUtil<A>::LG_K_BYTE]);
+  const uint8_t flags = data[HllUtil<A>::FLAGS_BYTE];
+  const bool compactFlag = (flags & HllUtil<A>::COMPACT_FLAG_MASK) ? true : false;
+  const bool oooFlag = (flags & HllUtil<A>::OUT_OF_ORDER_FLAG_MASK) ? true : false;
+  const bool emptyFlag = (flags & HllUtil<A>::EMPTY_FLAG_MASK) ? true : false;
+
+  wrapped_hll_sketch_alloc<A> sketch(data, mode, tgtHllType, lgK, compactFlag, oooFlag);
+  size_t expectedLength;
+  if (mode == LIST) {
+    sketch.coupon_count = emptyFlag ? 0 : data[HllUtil<A>::LIST_COUNT_BYTE];
+    if (sketch.coupon_count > 0) {
+      sketch.num_coupon_ints = compactFlag ? sketch.coupon_count
+          : 1 << HllUtil<A>::computeLgArrInts(LIST, sketch.coupon_count, lgK);
+    }
+    expectedLength = HllUtil<A>::LIST_INT_ARR_START + sketch.num_coupon_ints * sizeof(int);
+  } else if (mode == SET) {
+    if (len < static_cast<size_t>(HllUtil<A>::HASH_SET_INT_ARR_START)) {
+      throw std::invalid_argument("Input data length insufficient to hold CouponHashSet");
+    }
+    std::memcpy(&sketch.coupon_count, data + HllUtil<A>::HASH_SET_COUNT_INT, sizeof(int));
+    int lgArrInts = data[HllUtil<A>::LG_ARR_BYTE];
+    if (lgArrInts < HllUtil<A>::LG_INIT_SET_SIZE) {
+      lgArrInts = HllUtil<A>::computeLgArrInts(SET, sketch.coupon_count, lgK);
+    }
+    sketch.num_coupon_ints = compactFlag ? sketch.coupon_count : 1 << lgArrInts;
+    expectedLength = HllUtil<A>::HASH_SET_INT_ARR_START + sketch.num_coupon_ints * sizeof(int);
+  } else {
+    const int arrayBytes = HllArray<A>::hllArrBytes(tgtHllType, lgK);
+    if (len < static_cast<size_t>(HllUtil<A>::HLL_BYTE_ARR_START + arrayBytes)) {
+      throw std::invalid_argument("Input array too small to hold sketch image");
+    }
+    sketch.cur_min = data[HllUtil<A>::HLL_CUR_MIN_BYTE];
+    std::memcpy(&sketch.hip_accum, data + HllUtil<A>::HIP_ACCUM_DOUBLE, sizeof(double));
+    std::memcpy(&sketch.kxq0, data + HllUtil<A>::KXQ0_DOUBLE, sizeof(double));
+    std::memcpy(&sketch.kxq1, data + HllUtil<A>::KXQ1_DOUBLE, sizeof(double));
+    std::memcpy(&sketch.num_at_cur_min, data + HllUtil<A>::CUR_MIN_COUNT_INT, sizeof(int));
+    int auxCount;
+    std::memcpy(&auxCount, data + HllUtil<A>::AUX_COUNT_INT, sizeof(int));
+    if (auxCount > 0) { // necessarily HLL_4
+      sketch.num_aux_ints = compactFlag ? auxCount : 1 << data[HllUtil<A>::LG_ARR_BYTE];
+    }
+    expectedLength = HllUtil<A>::HLL_BYTE_ARR_START + arrayBytes + sketch.num_aux_ints * sizeof(int);
+  }
+  if (len < expectedLength) {
+    throw std::invalid_argument("Byte array too short for sketch. Expected " + std::to_string(expectedLength)
+                                + ", found: " + std::to_string(len));
+  }
+  return sketch;
+}
+
+template<typename A>
+double wrapped_hll_sketch_alloc<A>::get_estimate() const {
+  if (mode != HLL) {
+    return get_coupon_estimate(1.0);
+  }
+  return out_of_order ? get_composite_estimate() : hip_accum;
+}
+
+template<typename A>
+double wrapped_hll_sketch_alloc<A>::get_composite_estimate() const {
+  if (mode != HLL) {
+    return get_coupon_estimate(1.0);
+  }
+  return HllArray<A>::computeCompositeEstimate(lg_config_k, kxq0 + kxq1, cur_min, num_at_cur_min);
+}
+
+template<typename A>
+double wrapped_hll_sketch_alloc<A>::get_lower_bound(const int num_std_dev) const {
+  if (mode != HLL) {
+    HllUtil<A>::checkNumStdDev(num_std_dev);
+    return get_coupon_estimate(1.0 + (num_std_dev * HllUtil<A>::COUPON_RSE));
+  }
+  return HllArray<A>::computeLowerBound(lg_config_k, out_of_order, get_estimate(),
+                                        cur_min, num_at_cur_min, num_std_dev);
+}
+
+template<typename A>
+double wrapped_hll_sketch_alloc<A>::get_upper_bound(const int num_std_dev) const {
+  if (mode != HLL) {
+    HllUtil<A>::checkNumStdDev(num_std_dev);
+    return get_coupon_estimate(1.0 - (num_std_dev * HllUtil<A>::COUPON_RSE));
+  }
+  return HllArray<A>::computeUpperBound(lg_config_k, out_of_order, get_estimate(), num_std_dev);
+}
+
+template<typename A>
+double wrapped_hll_sketch_alloc<A>::get_coupon_estimate(const double rse_divisor) const {
+  const double est = CubicInterpolation<A>::usingXAndYTables(coupon_count);
+  return fmax(est / rse_divisor, coupon_count);
+}
+
+template<typename A>
+int wrapped_hll_sketch_alloc<A>::get_lg_config_k() const {
+  return lg_config_k;
+}
+
+template<typename A>
+target_hll_type wrapped_hll_sketch_alloc<A>::get_target_type() const {
+  return tgt_type;
+}
+
+template<typename A>
+bool wrapped_hll_sketch_alloc<A>::is_compact() const {
+  return compact;
+}
+
+template<typename A>
+bool wrapped_hll_sketch_alloc<A>::is_empty() const {
+  if (mode != HLL) {
+    return coupon_count == 0;
+  }
+  return (cur_min == 0) && (num_at_cur_min == (1 << lg_config_k));
+}
+
+template<typename A>
+int wrapped_hll_sketch_alloc<A>::get_coupon(const int i) const {
+  const int start = (mode == LIST) ? HllUtil<A>::LIST_INT_ARR_START : HllUtil<A>::HASH_SET_INT_ARR_START;
+  int coupon;
+  std::memcpy(&coupon, data + start + i * sizeof(int), sizeof(int));
+  return coupon;
+}
+
+template<typename A>
+void wrapped_hll_sketch_alloc<A>::merge_registers(Hll8Array<A>& dst) const {
+  const uint8_t* hllArr = data + HllUtil<A>::HLL_BYTE_ARR_START;
+  const uint8_t* auxInts = hllArr + HllArray<A>::hllArrBytes(tgt_type, lg_config_k);
+  dst.mergeHll(lg_config_k, tgt_type, hllArr, cur_min, auxInts, num_aux_ints);
+}
+
+template<typename A>
+size_t wrapped_hll_sketch_alloc<A>::get_serialized_size_bytes(const uint8_t* preamble) {
+  const int preInts = preamble[HllUtil<A>::PREAMBLE_INTS_BYTE];
+  const int lgK = HllUtil<A>::checkLgK(preamble[HllUtil<A>::LG_K_BYTE]);
+  const int lgArrInts = preamble[HllUtil<A>::LG_ARR_BYTE];
+  const bool compactFlag = (preamble[HllUtil<A>::FLAGS_BYTE] & HllUtil<A>::COMPACT_FLAG_MASK) ? true : false;
+  const bool emptyFlag = (preamble[HllUtil<A>::FLAGS_BYTE] & HllUtil<A>::EMPTY_FLAG_MASK) ? true : false;
+
+  if (preInts == HllUtil<A>::HLL_PREINTS) {
+    const target_hll_type tgtHllType = HllSketchImpl<A>::extractTgtHllType(preamble[HllUtil<A>::MODE_BYTE]);
+    int auxCount;
+    std::memcpy(&auxCount, preamble + HllUtil<A>::AUX_COUNT_INT, sizeof(int));
+    int auxInts = 0;
+    if (compactFlag) {
+      auxInts = auxCount;
+    } else if (tgtHllType == HLL_4) {
+      // updatable images reserve the aux space even when unused
+      auxInts = 1 << (lgArrInts > 0 ? lgArrInts : HllUtil<A>::LG_AUX_ARR_INTS[lgK]);
+    }
+    return HllUtil<A>::HLL_BYTE_ARR_START + HllArray<A>::hllArrBytes(tgtHllType, lgK) + auxInts * sizeof(int);
+  }
+
+  int couponCount;
+  int arrStart;
+  hll_mode mode;
+  if (preInts == HllUtil<A>::LIST_PREINTS) {
+    couponCount = emptyFlag ? 0 : preamble[HllUtil<A>::LIST_COUNT_BYTE];
+    arrStart = HllUtil<A>::LIST_INT_ARR_START;
+    mode = LIST;
+  } else if (preInts == HllUtil<A>::HASH_SET_PREINTS) {
+    std::memcpy(&couponCount, preamble + HllUtil<A>::HASH_SET_COUNT_INT, sizeof(int));
+    arrStart = HllUtil<A>::HASH_SET_INT_ARR_START;
+    mode = SET;
+  } else {
+    throw std::invalid_argument("Attempt to deserialize unknown object type");
+  }
+  if (compactFlag) {
+    return arrStart + couponCount * sizeof(int);
+  }
+  const int minLgArrInts = (mode == LIST) ? HllUtil<A>::LG_INIT_LIST_SIZE : HllUtil<A>::LG_INIT_SET_SIZE;
+  const int lgCouponArrInts = (lgArrInts < minLgArrInts) ? HllUtil<A>::computeLgArrInts(mode, couponCount, lgK) : lgArrInts;
+  return arrStart + (1 << lgCouponArrInts) * sizeof(int);
+}
+
+}
+
+#endif // _HLLWRAPPEDSKETCH_INTERNAL_HPP_
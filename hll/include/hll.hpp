@@ -105,6 +105,18 @@ class HllSketchImpl;
 template<typename A>
 class hll_union_alloc;
 
+template<typename A>
+class CouponList;
+
+template<typename A>
+class Hll8Array;
+
+template<typename A>
+class concurrent_hll_sketch_alloc;
+
+template<typename A>
+class wrapped_hll_sketch_alloc;
+
 template<typename A> using AllocU8 = typename std::allocator_traits<A>::template rebind_alloc<uint8_t>;
 template<typename A> using vector_u8 = std::vector<uint8_t, AllocU8<A>>;
 
@@ -296,6 +308,55 @@ class hll_sketch_alloc final {
      */
     void update(const void* data, size_t length_bytes);
 
+    /**
+     * Present an item hashed by the caller as a potential unique item.
+     * The hash must be computed as MurmurHash3_x64_128(data, length_bytes, seed),
+     * which makes it equivalent to update(data, length_bytes), so the same hash
+     * can be presented to several sketches.
+     * @param h0 The first 64-bit half of the hash (HashState::h1).
+     * @param h1 The second 64-bit half of the hash (HashState::h2).
+     * @param seed The seed used for hashing, must be the HLL update seed.
+     */
+    void update_hashed(uint64_t h0, uint64_t h1, uint64_t seed = HllUtil<A>::DEFAULT_UPDATE_SEED);
+
+    /**
+     * Present an array of unsigned 64-bit integers as potential unique items.
+     * Equivalent to calling update(uint64_t) for each item in order, which
+     * keeps the HIP estimate identical. Items are hashed in blocks ahead of
+     * being applied to the sketch.
+     * @param values The given integers.
+     * @param num The number of integers.
+     */
+    void update_batch(const uint64_t* values, size_t num);
+
+    /**
+     * Present an array of signed 64-bit integers as potential unique items.
+     * Equivalent to calling update(int64_t) for each item in order.
+     * @param values The given integers.
+     * @param num The number of integers.
+     */
+    void update_batch(const int64_t* values, size_t num);
+
+    /**
+     * Present an array of strings as potential unique items.
+     * Equivalent to calling update(const std::string&) for each item in order,
+     * so empty strings are ignored.
+     * @param values The given strings.
+     * @param num The number of strings.
+     */
+    void update_batch(const std::string* values, size_t num);
+
+    /**
+     * Present an array of variable length items as potential unique items.
+     * Item i is the sequence of bytes from data + offsets[i] to data + offsets[i + 1],
+     * so the offsets array must have num + 1 elements (Apache Arrow binary layout).
+     * Empty items are ignored as in update(const std::string&).
+     * @param data The concatenated items.
+     * @param offsets The start offset of each item followed by the end of the last one.
+     * @param num The number of items.
+     */
+    void update_batch(const char* data, const uint32_t* offsets, size_t num);
+
     /**
      * Returns the current cardinality estimate
      * @return the cardinality estimate
@@ -399,7 +460,29 @@ class hll_sketch_alloc final {
   private:
     explicit hll_sketch_alloc(HllSketchImpl<A>* that);
 
+    // number of items hashed ahead of being applied in batch updates
+    static const unsigned BATCH_SIZE = 16;
+
+    // hashing of all supported item types, HllUtil<A>::EMPTY for empty strings and null arrays
+    static int get_coupon(const std::string& datum);
+    static int get_coupon(uint64_t datum);
+    static int get_coupon(uint32_t datum);
+    static int get_coupon(uint16_t datum);
+    static int get_coupon(uint8_t datum);
+    static int get_coupon(int64_t datum);
+    static int get_coupon(int32_t datum);
+    static int get_coupon(int16_t datum);
+    static int get_coupon(int8_t datum);
+    static int get_coupon(double datum);
+    static int get_coupon(float datum);
+    static int get_coupon(const void* data, size_t length_bytes);
+
     void coupon_update(int coupon);
+    void coupon_update(const int* coupons, unsigned num);
+
+    // applies coupons to an HLL array of a known final type, so that the calls are resolved statically
+    template<typename HllArrayType>
+    static void array_coupon_update(HllArrayType* array, const int* coupons, unsigned num);
 
     std::string type_as_string() const;
     std::string mode_as_string() const;
@@ -414,6 +497,112 @@ class hll_sketch_alloc final {
 
     HllSketchImpl<A>* sketch_impl;
     friend hll_union_alloc<A>;
+    friend concurrent_hll_sketch_alloc<A>;
+};
+
+/**
+ * Read-only view of a serialized HLL sketch in any mode (list, set or HLL array),
+ * compact or updatable. It does not copy or own the bytes, which must outlive the view.
+ * Estimates and bounds are computed directly from the serialized form, and the view
+ * can be given to hll_union_alloc::update() to be merged without deserializing it.
+ */
+template<typename A = std::allocator<char> >
+class wrapped_hll_sketch_alloc {
+  public:
+    /**
+     * Wraps the given serialized image of an hll_sketch, validating the preamble.
+     * @param bytes The byte array to wrap, which must outlive the view.
+     * @param len Byte array length in bytes.
+     * @return A read-only view of the sketch.
+     */
+    static const wrapped_hll_sketch_alloc wrap(const void* bytes, size_t len);
+
+    /**
+     * Returns the current cardinality estimate
+     * @return the cardinality estimate
+     */
+    double get_estimate() const;
+
+    /**
+     * Returns the composite (non-HIP) estimate, see hll_sketch_alloc::get_composite_estimate()
+     * @return the composite cardinality estimate
+     */
+    double get_composite_estimate() const;
+
+    /**
+     * Returns the approximate lower error bound given the specified
+     * number of standard deviations.
+     * @param num_std_dev Number of standard deviations, an integer from the set  {1, 2, 3}.
+     * @return The approximate lower bound.
+     */
+    double get_lower_bound(int num_std_dev) const;
+
+    /**
+     * Returns the approximate upper error bound given the specified
+     * number of standard deviations.
+     * @param num_std_dev Number of standard deviations, an integer from the set  {1, 2, 3}.
+     * @return The approximate upper bound.
+     */
+    double get_upper_bound(int num_std_dev) const;
+
+    /**
+     * Returns sketch's configured lg_k value.
+     * @return Configured lg_k value.
+     */
+    int get_lg_config_k() const;
+
+    /**
+     * Returns the sketch's target HLL mode (from #target_hll_type).
+     * @return The sketch's target HLL mode.
+     */
+    target_hll_type get_target_type() const;
+
+    /**
+     * Indicates if the sketch was serialized in compact form.
+     * @return True if the sketch is in compact form.
+     */
+    bool is_compact() const;
+
+    /**
+     * Indicates if the sketch is empty.
+     * @return True if the sketch is empty.
+     */
+    bool is_empty() const;
+
+  private:
+    wrapped_hll_sketch_alloc(const uint8_t* data, hll_mode mode, target_hll_type tgt_type,
+                             int lg_config_k, bool compact, bool out_of_order);
+
+    // coupon estimator of CouponList, divided by the given relative error term
+    double get_coupon_estimate(double rse_divisor) const;
+
+    // list and set mode: reads the i-th entry of the (possibly unaligned) coupon array
+    int get_coupon(int i) const;
+
+    // HLL mode: register-wise max into the given array
+    void merge_registers(Hll8Array<A>& dst) const;
+
+    // size of the image as serialized, given its preamble (preInts ints)
+    static size_t get_serialized_size_bytes(const uint8_t* preamble);
+
+    const uint8_t* data;
+    hll_mode mode;
+    target_hll_type tgt_type;
+    int lg_config_k;
+    bool compact;
+    bool out_of_order;
+    // list and set mode
+    int coupon_count;
+    int num_coupon_ints; // including empty entries of an updatable image
+    // HLL mode
+    int cur_min;
+    int num_at_cur_min;
+    int num_aux_ints; // including empty entries of an updatable image
+    double hip_accum;
+    double kxq0;
+    double kxq1;
+
+    friend hll_union_alloc<A>;
 };
 
 /**
@@ -614,6 +803,29 @@ class hll_union_alloc {
      * @param The given sketch.
      */
     void update(const hll_sketch_alloc<A>& sketch);
+
+    /**
+     * Update this union operator with the given serialized sketch, merging
+     * its coupons or registers directly from the wrapped bytes.
+     * @param sketch The given sketch view.
+     */
+    void update(const wrapped_hll_sketch_alloc<A>& sketch);
+
+    /**
+     * Update this union operator with the given serialized sketch, merging
+     * it directly from the bytes, without deserializing it.
+     * @param bytes The serialized image of an hll_sketch.
+     * @param len Byte array length in bytes.
+     */
+    void update_from_bytes(const void* bytes, size_t len);
+
+    /**
+     * Update this union operator with all the sketches in the given stream of
+     * concatenated serialized sketches, read until the end of the stream.
+     * Each sketch is read into a buffer reused for the whole stream and merged from there.
+     * @param is The input stream from which to read.
+     */
+    void update_from_bytes(std::istream& is);
   
     /**
      * Present the given std::string as a potential unique item.
@@ -726,6 +938,7 @@ class hll_union_alloc {
     void union_impl(HllSketchImpl<A>* incoming_impl, int lg_max_k);
 
     static HllSketchImpl<A>* copy_or_downsample(HllSketchImpl<A>* src_impl, int tgt_lg_k);
+    static HllSketchImpl<A>* copy_or_downsample(const wrapped_hll_sketch_alloc<A>& src, int tgt_lg_k);
 
     void coupon_update(int coupon);
 
@@ -737,6 +950,15 @@ class hll_union_alloc {
     // calls couponUpdate on sketch, freeing the old sketch upon changes in hll_mode
     static HllSketchImpl<A>* leak_free_coupon_update(HllSketchImpl<A>* impl, int coupon);
 
+    // stores the composite estimate of an out-of-order HLL gadget, for repeated queries
+    void refresh_gadget_estimate();
+
+    // reads exactly len bytes or throws
+    static void read_bytes(std::istream& is, uint8_t* dst, size_t len);
+
+    // applies the coupons of a list or set to an HLL_8 array without virtual calls per coupon
+    static void merge_coupons(Hll8Array<A>* dst, const CouponList<A>* src);
+
     int lg_max_k;
     hll_sketch_alloc<A> gadget;
 };
@@ -753,6 +975,9 @@ typedef hll_sketch_alloc<> hll_sketch;
 /// convenience alias for hll_union with default allocator
 typedef hll_union_alloc<> hll_union;
 
+/// convenience alias for wrapped_hll_sketch with default allocator
+typedef wrapped_hll_sketch_alloc<> wrapped_hll_sketch;
+
 } // namespace datasketches
 
 #include "hll.private.hpp"
@@ -30,6 +30,7 @@
 #include "HllSketch-internal.hpp"
 #include "HllSketchImpl-internal.hpp"
 #include "HllUnion-internal.hpp"
+#include "HllWrappedSketch-internal.hpp"
 #include "IntArrayPairIterator-internal.hpp"
 
 #endif // _HLL_PRIVATE_HPP_
@@ -0,0 +1,142 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+#ifndef _HLL_CONCURRENT_SKETCH_HPP_
+#define _HLL_CONCURRENT_SKETCH_HPP_
+
+#include "hll.hpp"
+
+#include <atomic>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace datasketches {
+
+/**
+ * HLL_8 sketch that many threads can update at once without locking.
+ *
+ * <p>The registers are kept as bytes packed in 32-bit atomic words, and every update
+ * raises its register with a compare-and-swap loop on the enclosing word. There are
+ * no per-thread copies, so the memory footprint stays at about <i>K</i> bytes.
+ *
+ * <p>The serial HIP accumulator depends on the order of updates, which is not defined
+ * across threads, so this sketch uses the composite estimator instead, just like a union.
+ * The estimate and bounds are computed from a snapshot of the registers when first
+ * requested after a register change, and cached until the next change.
+ * Concurrent updates may or may not be reflected in them.
+ */
+template<typename A = std::allocator<char> >
+class concurrent_hll_sketch_alloc {
+  public:
+    /**
+     * Constructs a new concurrent HLL_8 sketch.
+     * @param lg_config_k Sketch can hold 2^lg_config_k rows
+     */
+    explicit concurrent_hll_sketch_alloc(int lg_config_k);
+
+    concurrent_hll_sketch_alloc(const concurrent_hll_sketch_alloc<A>& other) = delete;
+    concurrent_hll_sketch_alloc<A>& operator=(const concurrent_hll_sketch_alloc<A>& other) = delete;
+
+    /**
+     * Present the given item as a potential unique item, hashed as in hll_sketch_alloc.
+     * These methods are lock-free and may be called from any number of threads.
+     * @param datum The given item.
+     */
+    void update(const std::string& datum);
+    void update(uint64_t datum);
+    void update(uint32_t datum);
+    void update(uint16_t datum);
+    void update(uint8_t datum);
+    void update(int64_t datum);
+    void update(int32_t datum);
+    void update(int16_t datum);
+    void update(int8_t datum);
+    void update(double datum);
+    void update(float datum);
+    void update(const void* data, size_t length_bytes);
+
+    /**
+     * Returns the cardinality estimate of a recent snapshot.
+     * @return the cardinality estimate
+     */
+    double get_estimate() const;
+
+    /**
+     * Returns the approximate lower error bound of a recent snapshot.
+     * @param num_std_dev Number of standard deviations, an integer from the set  {1, 2, 3}.
+     * @return The approximate lower bound.
+     */
+    double get_lower_bound(int num_std_dev) const;
+
+    /**
+     * Returns the approximate upper error bound of a recent snapshot.
+     * @param num_std_dev Number of standard deviations, an integer from the set  {1, 2, 3}.
+     * @return The approximate upper bound.
+     */
+    double get_upper_bound(int num_std_dev) const;
+
+    /**
+     * Returns sketch's configured lg_k value.
+     * @return Configured lg_k value.
+     */
+    int get_lg_config_k() const;
+
+    /**
+     * Indicates if no register has been set so far.
+     * @return True if the sketch is empty.
+     */
+    bool is_empty() const;
+
+    /**
+     * Copies the registers into a regular HLL_8 sketch in HLL mode.
+     * The out-of-order flag of the result is set, so it uses the composite estimator.
+     * @return A snapshot of this sketch.
+     */
+    hll_sketch_alloc<A> get_result() const;
+
+  private:
+    typedef typename std::allocator_traits<A>::template rebind_alloc<std::atomic<uint32_t>> AllocAtomicU32;
+
+    const int lg_config_k;
+    // register i is byte i % 4 of word i / 4, counting from the least significant byte
+    std::vector<std::atomic<uint32_t>, AllocAtomicU32> registers;
+    // set on register changes, only written when clear so that the cache line stays shared
+    // between updating threads; cleared when the cached estimates are refreshed
+    mutable std::atomic<bool> is_dirty;
+    // set on the first register change, never cleared
+    std::atomic<bool> has_registers;
+
+    mutable std::mutex cache_mutex;
+    mutable double cached_estimate;
+    mutable double cached_lower_bounds[3];
+    mutable double cached_upper_bounds[3];
+
+    void coupon_update(int coupon);
+    void refresh_cache() const;
+};
+
+/// convenience alias for concurrent_hll_sketch with default allocator
+typedef concurrent_hll_sketch_alloc<> concurrent_hll_sketch;
+
+} // namespace datasketches
+
+#include "HllConcurrentSketch-internal.hpp"
+
+#endif // _HLL_CONCURRENT_SKETCH_HPP_
@@ -0,0 +1,109 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+#include "hll_concurrent_sketch.hpp"
+
+#include <cppunit/TestFixture.h>
+#include <cppunit/extensions/HelperMacros.h>
+
+#include <thread>
+#include <vector>
+
+namespace datasketches {
+
+class HllConcurrentSketchTest : public CppUnit::TestFixture {
+
+  CPPUNIT_TEST_SUITE(HllConcurrentSketchTest);
+  CPPUNIT_TEST(checkInvalidLgK);
+  CPPUNIT_TEST(checkEmpty);
+  CPPUNIT_TEST(checkSingleThread);
+  CPPUNIT_TEST(checkMultipleThreads);
+  CPPUNIT_TEST_SUITE_END();
+
+  // registers must match those of a regular HLL_8 sketch given the same values
+  void checkSameRegisters(const hll_sketch& expected, const hll_sketch& actual) {
+    pair_iterator_with_deleter<> expectedItr = expected.get_iterator();
+    pair_iterator_with_deleter<> actualItr = actual.get_iterator();
+    while (expectedItr->nextAll()) {
+      CPPUNIT_ASSERT(actualItr->nextAll());
+      CPPUNIT_ASSERT_EQUAL(expectedItr->getValue(), actualItr->getValue());
+    }
+  }
+
+  void checkInvalidLgK() {
+    CPPUNIT_ASSERT_THROW(concurrent_hll_sketch(3), std::invalid_argument);
+    CPPUNIT_ASSERT_THROW(concurrent_hll_sketch(22), std::invalid_argument);
+  }
+
+  void checkEmpty() {
+    concurrent_hll_sketch sketch(10);
+    sketch.update(std::string()); // ignored
+    sketch.update(nullptr, 0); // ignored
+    CPPUNIT_ASSERT(sketch.is_empty());
+    CPPUNIT_ASSERT_EQUAL(0.0, sketch.get_estimate());
+    CPPUNIT_ASSERT_EQUAL(0.0, sketch.get_lower_bound(1));
+    CPPUNIT_ASSERT_EQUAL(0.0, sketch.get_upper_bound(1));
+    CPPUNIT_ASSERT(sketch.get_result().is_empty());
+  }
+
+  void checkSingleThread() {
+    concurrent_hll_sketch sketch(10);
+    hll_sketch reference(10, HLL_8, true);
+    for (int n: {10, 1000, 100000}) {
+      for (int i = 0; i < n; i++) {
+        sketch.update(i);
+        reference.update(i);
+      }
+      // the cached estimate must follow the updates
+      const hll_sketch result = sketch.get_result();
+      checkSameRegisters(reference, result);
+      CPPUNIT_ASSERT_DOUBLES_EQUAL(reference.get_composite_estimate(), sketch.get_estimate(), 1e-6);
+      CPPUNIT_ASSERT_EQUAL(result.get_estimate(), sketch.get_estimate());
+      CPPUNIT_ASSERT_EQUAL(result.get_lower_bound(2), sketch.get_lower_bound(2));
+      CPPUNIT_ASSERT_EQUAL(result.get_upper_bound(2), sketch.get_upper_bound(2));
+      CPPUNIT_ASSERT_DOUBLES_EQUAL(n, sketch.get_estimate(), n * 0.1);
+    }
+    CPPUNIT_ASSERT(!sketch.is_empty());
+    CPPUNIT_ASSERT_THROW(sketch.get_lower_bound(4), std::invalid_argument);
+  }
+
+  void checkMultipleThreads() {
+    const int numThreads = 4;
+    const int numPerThread = 50000;
+    concurrent_hll_sketch sketch(12);
+    std::vector<std::thread> threads;
+    for (int t = 0; t < numThreads; t++) {
+      threads.emplace_back([&sketch, t]() {
+        // the ranges overlap by half, so threads race on the same registers
+        for (int i = 0; i < numPerThread; i++) sketch.update(t * numPerThread / 2 + i);
+      });
+    }
+    for (auto& thread: threads) thread.join();
+
+    hll_sketch reference(12, HLL_8);
+    for (int i = 0; i < (numThreads + 1) * numPerThread / 2; i++) reference.update(i);
+    checkSameRegisters(reference, sketch.get_result());
+    CPPUNIT_ASSERT_DOUBLES_EQUAL(reference.get_composite_estimate(), sketch.get_estimate(), 1e-6);
+  }
+
+};
+
+CPPUNIT_TEST_SUITE_REGISTRATION(HllConcurrentSketchTest);
+
+} /* namespace datasketches */
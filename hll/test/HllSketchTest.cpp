@@ -19,6 +19,9 @@
 
 #include "hll.hpp"
 
+#include <string>
+#include <vector>
+
 #include <cppunit/TestFixture.h>
 #include <cppunit/extensions/HelperMacros.h>
 
@@ -36,6 +39,9 @@ class hllSketchTest : public CppUnit::TestFixture {
   CPPUNIT_TEST(checkCompactFlag);
   CPPUNIT_TEST(checkKLimits);
   CPPUNIT_TEST(checkInputTypes);
+  CPPUNIT_TEST(checkUpdateHashed);
+  CPPUNIT_TEST(checkUpdateBatch);
+  CPPUNIT_TEST(checkWrappedSketch);
   CPPUNIT_TEST_SUITE_END();
 
   void checkCopies() {
@@ -313,6 +319,102 @@ class hllSketchTest : public CppUnit::TestFixture {
     CPPUNIT_ASSERT(sk.is_empty());
   }
 
+  void checkUpdateHashed() {
+    for (target_hll_type type: {target_hll_type::HLL_4, target_hll_type::HLL_6, target_hll_type::HLL_8}) {
+      hll_sketch sk1(10, type);
+      hll_sketch sk2(10, type);
+      for (uint64_t i = 0; i < 10000; i++) {
+        sk1.update(i);
+        HashState hashes;
+        MurmurHash3_x64_128(&i, sizeof(i), HllUtil<>::DEFAULT_UPDATE_SEED, hashes);
+        sk2.update_hashed(hashes.h1, hashes.h2);
+      }
+      CPPUNIT_ASSERT_EQUAL(sk1.get_estimate(), sk2.get_estimate());
+      CPPUNIT_ASSERT_EQUAL(sk1.get_composite_estimate(), sk2.get_composite_estimate());
+      CPPUNIT_ASSERT_THROW(sk2.update_hashed(1, 1, 123), std::invalid_argument);
+    }
+  }
+
+  void checkUpdateBatch() {
+    for (target_hll_type type: {target_hll_type::HLL_4, target_hll_type::HLL_6, target_hll_type::HLL_8}) {
+      // through list, set and HLL modes, with a batch size not aligned to the internal block
+      for (int n: {5, 100, 10000}) {
+        std::vector<uint64_t> values(n);
+        std::vector<std::string> strings(n);
+        std::string data;
+        std::vector<uint32_t> offsets(1, 0);
+        for (int i = 0; i < n; i++) {
+          values[i] = i;
+          strings[i] = i % 10 == 0 ? "" : std::to_string(i);
+          data += strings[i];
+          offsets.push_back(data.size());
+        }
+
+        hll_sketch sk1(10, type);
+        hll_sketch sk2(10, type);
+        for (uint64_t value: values) sk1.update(value);
+        sk2.update_batch(values.data(), n);
+        CPPUNIT_ASSERT_EQUAL(sk1.get_estimate(), sk2.get_estimate());
+        CPPUNIT_ASSERT(sk1.serialize_updatable() == sk2.serialize_updatable());
+
+        hll_sketch sk3(10, type);
+        hll_sketch sk4(10, type);
+        hll_sketch sk5(10, type);
+        for (const std::string& str: strings) sk3.update(str);
+        sk4.update_batch(strings.data(), n);
+        sk5.update_batch(data.data(), offsets.data(), n);
+        CPPUNIT_ASSERT_EQUAL(sk3.get_estimate(), sk4.get_estimate());
+        CPPUNIT_ASSERT(sk3.serialize_updatable() == sk4.serialize_updatable());
+        CPPUNIT_ASSERT(sk3.serialize_updatable() == sk5.serialize_updatable());
+      }
+    }
+  }
+
+  void checkWrappedMatches(const hll_sketch& sk) {
+    for (bool compact: {true, false}) {
+      auto bytes = compact ? sk.serialize_compact() : sk.serialize_updatable();
+      auto view = wrapped_hll_sketch::wrap(bytes.data(), bytes.size());
+      CPPUNIT_ASSERT_EQUAL(sk.is_empty(), view.is_empty());
+      CPPUNIT_ASSERT_EQUAL(compact, view.is_compact());
+      CPPUNIT_ASSERT_EQUAL(sk.get_lg_config_k(), view.get_lg_config_k());
+      CPPUNIT_ASSERT_EQUAL(sk.get_target_type(), view.get_target_type());
+      CPPUNIT_ASSERT_EQUAL(sk.get_estimate(), view.get_estimate());
+      CPPUNIT_ASSERT_EQUAL(sk.get_composite_estimate(), view.get_composite_estimate());
+      for (int num_std_dev = 1; num_std_dev <= 3; num_std_dev++) {
+        CPPUNIT_ASSERT_EQUAL(sk.get_lower_bound(num_std_dev), view.get_lower_bound(num_std_dev));
+        CPPUNIT_ASSERT_EQUAL(sk.get_upper_bound(num_std_dev), view.get_upper_bound(num_std_dev));
+      }
+      // updatable HLL_4 images reserve aux space that may be unused
+      if (compact && !sk.is_empty()) {
+        CPPUNIT_ASSERT_THROW(wrapped_hll_sketch::wrap(bytes.data(), bytes.size() - 1), std::invalid_argument);
+      }
+    }
+  }
+
+  void checkWrappedSketch() {
+    for (target_hll_type type: {target_hll_type::HLL_4, target_hll_type::HLL_6, target_hll_type::HLL_8}) {
+      // empty, list, set and HLL modes, in order and (from a union) out of order
+      for (int n: {0, 5, 100, 10000}) {
+        hll_sketch sk1(10, type);
+        hll_sketch sk2(10, type);
+        for (int i = 0; i < n; i++) {
+          sk1.update(i);
+          sk2.update(i + n / 2);
+        }
+        checkWrappedMatches(sk1);
+        hll_union u(10);
+        u.update(sk1);
+        u.update(sk2);
+        checkWrappedMatches(u.get_result(type));
+      }
+    }
+
+    hll_sketch sk(10);
+    auto bytes = sk.serialize_compact();
+    bytes[2] = 0; // family id
+    CPPUNIT_ASSERT_THROW(wrapped_hll_sketch::wrap(bytes.data(), bytes.size()), std::invalid_argument);
+    CPPUNIT_ASSERT_THROW(wrapped_hll_sketch::wrap(bytes.data(), 4), std::invalid_argument);
+  }
 };
 
 CPPUNIT_TEST_SUITE_REGISTRATION(hllSketchTest);
@@ -19,6 +19,8 @@
 
 #include "hll.hpp"
 
+#include <sstream>
+
 #include <cppunit/TestFixture.h>
 #include <cppunit/extensions/HelperMacros.h>
 
@@ -39,6 +41,10 @@ class HllUnionTest : public CppUnit::TestFixture {
   CPPUNIT_TEST(checkConversions);
   CPPUNIT_TEST(checkMisc);
   CPPUNIT_TEST(checkInputTypes);
+  CPPUNIT_TEST(checkHllArrayMerge);
+  CPPUNIT_TEST(checkCachedEstimate);
+  CPPUNIT_TEST(checkWrappedUpdate);
+  CPPUNIT_TEST(checkUpdateFromBytes);
   CPPUNIT_TEST_SUITE_END();
 
   int min(int a, int b) {
@@ -381,6 +387,122 @@ class HllUnionTest : public CppUnit::TestFixture {
     u.update("");
     CPPUNIT_ASSERT(u.is_empty());
   }
+
+  void checkHllArrayMerge() {
+    // merging HLL arrays of any type, including folding a larger lgConfigK,
+    // must give the same registers as a single HLL_8 sketch fed all values
+    for (target_hll_type type: {HLL_4, HLL_6, HLL_8}) {
+      for (int srcLgK: {10, 12}) {
+        hll_union u(10);
+        hll_sketch direct(10, HLL_8);
+        uint64_t value = 0;
+        for (int s = 0; s < 4; s++) {
+          hll_sketch sk(srcLgK, type);
+          for (int i = 0; i < 20000; i++) {
+            sk.update(value);
+            direct.update(value++);
+          }
+          u.update(sk);
+        }
+        hll_sketch result = u.get_result(HLL_8);
+        pair_iterator_with_deleter<> resultItr = result.get_iterator();
+        pair_iterator_with_deleter<> directItr = direct.get_iterator();
+        while (directItr->nextAll()) {
+          CPPUNIT_ASSERT(resultItr->nextAll());
+          CPPUNIT_ASSERT_EQUAL(directItr->getValue(), resultItr->getValue());
+        }
+        CPPUNIT_ASSERT_DOUBLES_EQUAL(direct.get_composite_estimate(), result.get_composite_estimate(), 1e-6);
+        CPPUNIT_ASSERT_DOUBLES_EQUAL(direct.get_composite_estimate(), u.get_estimate(), 1e-6);
+      }
+    }
+  }
+
+  void checkCachedEstimate() {
+    // repeated queries and further updates must agree with a freshly deserialized copy
+    hll_union u(12);
+    uint64_t value = 0;
+    for (int n: {100, 1000, 100000}) {
+      hll_sketch sk(12, HLL_8);
+      for (int i = 0; i < n; i++) sk.update(value++);
+      u.update(sk);
+      for (int i = 0; i < 2; i++) {
+        auto bytes = u.serialize_updatable();
+        hll_union fresh = hll_union::deserialize(bytes.data(), bytes.size());
+        CPPUNIT_ASSERT_EQUAL(fresh.get_estimate(), u.get_estimate());
+        CPPUNIT_ASSERT_EQUAL(fresh.get_lower_bound(1), u.get_lower_bound(1));
+        CPPUNIT_ASSERT_EQUAL(fresh.get_upper_bound(3), u.get_upper_bound(3));
+        u.update(value++); // single updates invalidate the cached estimate as well
+      }
+    }
+  }
+
+  void checkWrappedUpdate() {
+    // merging views must match merging deserialized sketches, from every gadget mode
+    // and with both smaller and larger source lgK than the union's
+    const int nArr[] = {0, 5, 100, 10000};
+    for (target_hll_type type: {target_hll_type::HLL_4, target_hll_type::HLL_6, target_hll_type::HLL_8}) {
+      for (int lgK: {10, 12}) {
+        for (int n1: nArr) {
+          for (int n2: nArr) {
+            hll_sketch sk1(lgK, type);
+            hll_sketch sk2(lgK + 1, type);
+            for (int i = 0; i < n1; i++) sk1.update(i);
+            for (int i = 0; i < n2; i++) sk2.update(i + n1 / 2);
+            for (bool compact: {true, false}) {
+              hll_union u1(11);
+              hll_union u2(11);
+              for (const hll_sketch* sk: {&sk1, &sk2}) {
+                auto bytes = compact ? sk->serialize_compact() : sk->serialize_updatable();
+                u1.update(hll_sketch::deserialize(bytes.data(), bytes.size()));
+                u2.update(wrapped_hll_sketch::wrap(bytes.data(), bytes.size()));
+                const double est = u1.get_estimate();
+                CPPUNIT_ASSERT_EQUAL(u1.get_lg_config_k(), u2.get_lg_config_k());
+                CPPUNIT_ASSERT_EQUAL(u1.is_empty(), u2.is_empty());
+                CPPUNIT_ASSERT_DOUBLES_EQUAL(est, u2.get_estimate(), est * 1e-12);
+                CPPUNIT_ASSERT_DOUBLES_EQUAL(u1.get_composite_estimate(), u2.get_composite_estimate(), est * 1e-12);
+                CPPUNIT_ASSERT_DOUBLES_EQUAL(u1.get_lower_bound(2), u2.get_lower_bound(2), est * 1e-12);
+                CPPUNIT_ASSERT_DOUBLES_EQUAL(u1.get_upper_bound(2), u2.get_upper_bound(2), est * 1e-12);
+              }
+            }
+          }
+        }
+      }
+    }
+  }
+
+  void checkUpdateFromBytes() {
+    // sketches of every type and mode, compact and updatable, concatenated in one stream
+    hll_union u1(11);
+    hll_union u2(11);
+    hll_union u3(11);
+    std::stringstream ss(std::ios::in | std::ios::out | std::ios::binary);
+    uint64_t value = 0;
+    for (target_hll_type type: {target_hll_type::HLL_4, target_hll_type::HLL_6, target_hll_type::HLL_8}) {
+      for (int n: {0, 5, 100, 1000, 100000}) {
+        for (bool compact: {true, false}) {
+          hll_sketch sk(10 + n % 3, type);
+          for (int i = 0; i < n; i++) sk.update(value++);
+          auto bytes = compact ? sk.serialize_compact() : sk.serialize_updatable();
+          u1.update(hll_sketch::deserialize(bytes.data(), bytes.size()));
+          u2.update_from_bytes(bytes.data(), bytes.size());
+          if (compact) sk.serialize_compact(ss); else sk.serialize_updatable(ss);
+        }
+      }
+    }
+    u3.update_from_bytes(ss);
+    const double est = u1.get_estimate();
+    CPPUNIT_ASSERT_DOUBLES_EQUAL(est, u2.get_estimate(), est * 1e-12);
+    CPPUNIT_ASSERT_DOUBLES_EQUAL(est, u3.get_estimate(), est * 1e-12);
+    CPPUNIT_ASSERT_DOUBLES_EQUAL(u1.get_lower_bound(1), u3.get_lower_bound(1), est * 1e-12);
+
+    // a stream cut in the middle of a sketch
+    hll_sketch sk(10);
+    for (int i = 0; i < 1000; i++) sk.update(i);
+    auto bytes = sk.serialize_compact();
+    std::stringstream truncated(std::ios::in | std::ios::out | std::ios::binary);
+    truncated.write(reinterpret_cast<const char*>(bytes.data()), bytes.size() - 1);
+    CPPUNIT_ASSERT_THROW(u3.update_from_bytes(truncated), std::invalid_argument);
+  }
 };
 
 CPPUNIT_TEST_SUITE_REGISTRATION(HllUnionTest);
@@ -32,6 +32,7 @@ class ToFromByteArrayTest : public CppUnit::TestFixture {
   CPPUNIT_TEST_SUITE(ToFromByteArrayTest);
   CPPUNIT_TEST(deserializeFromJava);
   CPPUNIT_TEST(toFromSketch);
+  CPPUNIT_TEST(updatableSetFromBytes);
   //CPPUNIT_TEST(doubleSerialize);
   CPPUNIT_TEST_SUITE_END();
 
@@ -174,6 +175,31 @@ class ToFromByteArrayTest : public CppUnit::TestFixture {
       }
     }
   }
+
+  void updatableSetFromBytes() {
+    // an updatable set keeps its coupons spread across the whole hash table,
+    // all of it must be restored, not just the first couponCount slots
+    const int lgK = 13;
+    const int n = 300;
+    hll_sketch src(lgK, HLL_8);
+    for (int i = 0; i < n; ++i) src.update(i);
+    CPPUNIT_ASSERT(src.to_string(true, false, false, false).find("SET") != std::string::npos);
+
+    auto bytes = src.serialize_updatable();
+    hll_sketch dst = hll_sketch::deserialize(bytes.data(), bytes.size());
+    checkSketchEquality(src, dst);
+
+    // the same items again must not change anything
+    for (int i = 0; i < n; ++i) dst.update(i);
+    checkSketchEquality(src, dst);
+
+    // promotion to HLL carries over all the coupons
+    for (int i = n; i < 10 * n; ++i) {
+      src.update(i);
+      dst.update(i);
+    }
+    CPPUNIT_ASSERT_DOUBLES_EQUAL(src.get_estimate(), dst.get_estimate(), src.get_estimate() * 1e-9);
+  }
 };
 
 CPPUNIT_TEST_SUITE_REGISTRATION(ToFromByteArrayTest);
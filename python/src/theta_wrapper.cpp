@@ -74,6 +74,11 @@ update_theta_sketch update_theta_sketch_deserialize(py::bytes skBytes,
   return update_theta_sketch::deserialize(skStr.c_str(), skStr.length(), seed);
 }
 
+py::object compact_theta_sketch_serialize_compressed(const compact_theta_sketch& sk) {
+  auto serResult = sk.serialize_compressed();
+  return py::bytes((char*)serResult.data(), serResult.size());
+}
+
 compact_theta_sketch compact_theta_sketch_deserialize(py::bytes skBytes,
                                                       uint64_t seed = update_theta_sketch::builder::DEFAULT_SEED) {
   std::string skStr = skBytes; // implicit cast  
@@ -119,6 +124,7 @@ void init_theta(py::module &m) {
   py::class_<compact_theta_sketch, theta_sketch>(m, "compact_theta_sketch")
     .def(py::init<const compact_theta_sketch&>())
     .def(py::init<const theta_sketch&, bool>())
+    .def("serialize_compressed", &dspy::compact_theta_sketch_serialize_compressed)
     .def_static("deserialize", &dspy::compact_theta_sketch_deserialize,
         py::arg("bytes"), py::arg("seed")=update_theta_sketch::builder::DEFAULT_SEED)
   ;
@@ -127,19 +133,22 @@ void init_theta(py::module &m) {
     .def(py::init(&dspy::theta_union_factory),
          py::arg("lg_k")=update_theta_sketch::builder::DEFAULT_LG_K, py::arg("p")=1.0, py::arg("seed")=update_theta_sketch::builder::DEFAULT_SEED)
     .def("update", &theta_union::update, py::arg("sketch"))
-    .def("get_result", &theta_union::get_result, py::arg("ordered")=true)
+    .def("get_result", (compact_theta_sketch (theta_union::*)(bool) const) &theta_union::get_result, py::arg("ordered")=true)
+    .def("reset", &theta_union::reset)
   ;
 
   py::class_<theta_intersection>(m, "theta_intersection")
     .def(py::init<uint64_t>(), py::arg("seed")=update_theta_sketch::builder::DEFAULT_SEED)
     .def(py::init<const theta_intersection&>())
     .def("update", &theta_intersection::update, py::arg("sketch"))
-    .def("get_result", &theta_intersection::get_result, py::arg("ordered")=true)
+    .def("get_result", (compact_theta_sketch (theta_intersection::*)(bool) const) &theta_intersection::get_result, py::arg("ordered")=true)
+    .def("reset", &theta_intersection::reset)
     .def("has_result", &theta_intersection::has_result)
   ;
 
   py::class_<theta_a_not_b>(m, "theta_a_not_b")
     .def(py::init<uint64_t>(), py::arg("seed")=update_theta_sketch::builder::DEFAULT_SEED)
-    .def("compute", &theta_a_not_b::compute, py::arg("a"), py::arg("b"), py::arg("ordered")=true)
+    .def("compute", (compact_theta_sketch (theta_a_not_b::*)(const theta_sketch&, const theta_sketch&, bool) const) &theta_a_not_b::compute,
+        py::arg("a"), py::arg("b"), py::arg("ordered")=true)
   ;
 }
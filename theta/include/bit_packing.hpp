@@ -0,0 +1,95 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+
+#ifndef BIT_PACKING_HPP_
+#define BIT_PACKING_HPP_
+
+#include <cstdint>
+
+namespace datasketches {
+
+/*
+ * Packing of values with a fixed number of bits (1 to 64) into a big-endian bit stream.
+ * The destination must be zero-initialized.
+ * The offset is the number of bits already used in the current byte.
+ */
+
+static inline uint8_t* pack_bits(uint64_t value, uint8_t bits, uint8_t* ptr, uint8_t& offset) {
+  if (offset > 0) {
+    const uint8_t chunk_bits = 8 - offset;
+    const uint8_t mask = (1 << chunk_bits) - 1;
+    if (bits < chunk_bits) {
+      *ptr |= (value << (chunk_bits - bits)) & mask;
+      offset += bits;
+      return ptr;
+    }
+    *ptr++ |= (value >> (bits - chunk_bits)) & mask;
+    bits -= chunk_bits;
+    offset = 0;
+  }
+  while (bits >= 8) {
+    bits -= 8;
+    *ptr++ = static_cast<uint8_t>(value >> bits);
+  }
+  if (bits > 0) {
+    *ptr = static_cast<uint8_t>(value << (8 - bits));
+    offset = bits;
+  }
+  return ptr;
+}
+
+static inline const uint8_t* unpack_bits(uint64_t& value, uint8_t bits, const uint8_t* ptr, uint8_t& offset) {
+  const uint8_t avail_bits = 8 - offset;
+  const uint8_t chunk_bits = avail_bits < bits ? avail_bits : bits;
+  const uint8_t mask = (1 << chunk_bits) - 1;
+  value = (*ptr >> (avail_bits - chunk_bits)) & mask;
+  ptr += (offset + chunk_bits) >> 3;
+  offset = (offset + chunk_bits) & 7;
+  bits -= chunk_bits;
+  while (bits >= 8) {
+    value <<= 8;
+    value |= *ptr++;
+    bits -= 8;
+  }
+  if (bits > 0) {
+    value <<= bits;
+    value |= *ptr >> (8 - bits);
+    offset = bits;
+  }
+  return ptr;
+}
+
+// a block of 8 values takes exactly the given number of bits in bytes,
+// so blocks start at byte boundaries and can be decoded independently
+static inline uint8_t* pack_bits_block8(const uint64_t* values, uint8_t bits, uint8_t* ptr) {
+  uint8_t offset = 0;
+  for (int i = 0; i < 8; ++i) ptr = pack_bits(values[i], bits, ptr, offset);
+  return ptr;
+}
+
+static inline const uint8_t* unpack_bits_block8(uint64_t* values, uint8_t bits, const uint8_t* ptr) {
+  uint8_t offset = 0;
+  for (int i = 0; i < 8; ++i) ptr = unpack_bits(values[i], bits, ptr, offset);
+  return ptr;
+}
+
+} /* namespace datasketches */
+
+#endif
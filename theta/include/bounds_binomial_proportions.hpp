@@ -0,0 +1,106 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+
+#ifndef BOUNDS_BINOMIAL_PROPORTIONS_HPP_
+#define BOUNDS_BINOMIAL_PROPORTIONS_HPP_
+
+#include <cmath>
+#include <stdexcept>
+
+#if defined(_MSC_VER)
+#include <iso646.h> // for and/or keywords
+#endif // _MSC_VER
+
+/*
+ * Confidence intervals for the success probability p of a binomial distribution
+ * given k successes in n trials, as in the Java class BoundsOnBinomialProportions.
+ * Used to bound ratios of counts of retained entries within the same sampled set,
+ * for instance the Jaccard similarity of two sketches.
+ * The approximation is formula 26.5.22 from Abramowitz and Stegun, exact for k = 0, 1, n - 1 and n.
+ */
+
+namespace datasketches {
+
+class bounds_binomial_proportions {
+public:
+  static double approximate_lower_bound_on_p(unsigned long long n, unsigned long long k, double num_std_devs) {
+    check_inputs(n, k);
+    if (n == 0) return 0.0; // the coin was never flipped, so we know nothing
+    if (k == 0) return 0.0;
+    if (k == 1) return exact_lower_bound_on_p_k_eq_1(n, delta_of_num_std_devs(num_std_devs));
+    if (k == n) return exact_lower_bound_on_p_k_eq_n(n, delta_of_num_std_devs(num_std_devs));
+    return 1.0 - abramowitz_stegun_formula_26p5p22((n - k) + 1.0, k, -num_std_devs);
+  }
+
+  static double approximate_upper_bound_on_p(unsigned long long n, unsigned long long k, double num_std_devs) {
+    check_inputs(n, k);
+    if (n == 0) return 1.0; // the coin was never flipped, so we know nothing
+    if (k == n) return 1.0;
+    if (k == n - 1) return exact_upper_bound_on_p_k_eq_n_minus_1(n, delta_of_num_std_devs(num_std_devs));
+    if (k == 0) return exact_upper_bound_on_p_k_eq_0(n, delta_of_num_std_devs(num_std_devs));
+    return 1.0 - abramowitz_stegun_formula_26p5p22(n - k, k + 1.0, num_std_devs);
+  }
+
+private:
+  static void check_inputs(unsigned long long n, unsigned long long k) {
+    if (k > n) throw std::invalid_argument("k cannot exceed n");
+  }
+
+  static double delta_of_num_std_devs(double kappa) {
+    return normal_cdf(-kappa);
+  }
+
+  static double normal_cdf(double x) {
+    return 0.5 * (1.0 + std::erf(x / std::sqrt(2.0)));
+  }
+
+  static double abramowitz_stegun_formula_26p5p22(double a, double b, double yp) {
+    const double b2m1 = 2.0 * b - 1.0;
+    const double a2m1 = 2.0 * a - 1.0;
+    const double lambda = (yp * yp - 3.0) / 6.0;
+    const double htmp = 1.0 / a2m1 + 1.0 / b2m1;
+    const double h = 2.0 / htmp;
+    const double term1 = (yp * std::sqrt(h + lambda)) / h;
+    const double term2 = 1.0 / b2m1 - 1.0 / a2m1;
+    const double term3 = (lambda + 5.0 / 6.0) - 2.0 / (3.0 * h);
+    const double w = term1 - term2 * term3;
+    return a / (a + b * std::exp(2.0 * w));
+  }
+
+  static double exact_upper_bound_on_p_k_eq_0(unsigned long long n, double delta) {
+    return 1.0 - std::pow(delta, 1.0 / n);
+  }
+
+  static double exact_lower_bound_on_p_k_eq_n(unsigned long long n, double delta) {
+    return std::pow(delta, 1.0 / n);
+  }
+
+  static double exact_lower_bound_on_p_k_eq_1(unsigned long long n, double delta) {
+    return 1.0 - std::pow(1.0 - delta, 1.0 / n);
+  }
+
+  static double exact_upper_bound_on_p_k_eq_n_minus_1(unsigned long long n, double delta) {
+    return std::pow(1.0 - delta, 1.0 / n);
+  }
+};
+
+} /* namespace datasketches */
+
+#endif
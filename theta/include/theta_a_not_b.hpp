@@ -25,6 +25,7 @@
 #include <climits>
 
 #include <theta_sketch.hpp>
+#include <theta_sorted_merge.hpp>
 
 namespace datasketches {
 
@@ -41,8 +42,15 @@ public:
 
   compact_theta_sketch_alloc<A> compute(const theta_sketch_alloc<A>& a, const theta_sketch_alloc<A>& b, bool ordered = true) const;
 
+  // A minus the union of a range of sketches (or pointers to sketches) in one pass over A.
+  // If all inputs are ordered, A is merged with all of them at once,
+  // otherwise keys of all of them are collected in a single hash table to probe.
+  template<typename Iterator>
+  compact_theta_sketch_alloc<A> compute(const theta_sketch_alloc<A>& a, Iterator first, Iterator last, bool ordered = true) const;
+
 private:
   typedef typename std::allocator_traits<A>::template rebind_alloc<uint64_t> AllocU64;
+  typedef typename std::allocator_traits<A>::template rebind_alloc<bool> AllocBool;
   uint16_t seed_hash_;
 
 };
@@ -21,6 +21,8 @@
 #define THETA_A_NOT_B_IMPL_HPP_
 
 #include <algorithm>
+#include <functional>
+#include <vector>
 
 namespace datasketches {
 
@@ -37,70 +39,101 @@ seed_hash_(theta_sketch_alloc<A>::get_seed_hash(seed))
 
 template<typename A>
 compact_theta_sketch_alloc<A> theta_a_not_b_alloc<A>::compute(const theta_sketch_alloc<A>& a, const theta_sketch_alloc<A>& b, bool ordered) const {
+  const theta_sketch_alloc<A>* bs[1] = { &b };
+  return compute(a, bs, &bs[1], ordered);
+}
+
+template<typename A>
+template<typename Iterator>
+compact_theta_sketch_alloc<A> theta_a_not_b_alloc<A>::compute(const theta_sketch_alloc<A>& a, Iterator first, Iterator last, bool ordered) const {
   if (a.is_empty()) return compact_theta_sketch_alloc<A>(a, ordered);
   if (a.get_seed_hash() != seed_hash_) throw std::invalid_argument("A seed hash mismatch");
-  if (b.get_seed_hash() != seed_hash_) throw std::invalid_argument("B seed hash mismatch");
-  if (a.get_num_retained() == 0 or b.is_empty()) return compact_theta_sketch_alloc<A>(a, ordered);
 
-  const uint64_t theta = std::min(a.get_theta64(), b.get_theta64());
-  uint64_t* keys = nullptr;
-  uint32_t keys_size = 0;
-  uint32_t count = 0;
-  bool is_empty = a.is_empty();
-
-  if (b.get_num_retained() == 0) {
-    for (auto key: a) if (key < theta) ++count;
-    keys_size = count;
-    keys = AllocU64().allocate(keys_size);
-    std::copy_if(a.begin(), a.end(), keys, [theta](uint64_t key) { return key < theta; });
-    if (ordered and !a.is_ordered()) std::sort(keys, &keys[keys_size]);
-    if (count == 0 and theta == theta_sketch_alloc<A>::MAX_THETA) is_empty = true;
-    return compact_theta_sketch_alloc<A>(is_empty, theta, keys, count, seed_hash_, a.is_ordered() or ordered);
+  uint64_t theta = a.get_theta64();
+  bool is_ordered = a.is_ordered();
+  bool all_b_empty = true;
+  uint32_t num_b = 0;
+  uint32_t num_b_keys = 0;
+  for (Iterator it = first; it != last; ++it) {
+    const theta_sketch_alloc<A>& b = as_theta_sketch<A>(*it);
+    if (b.get_seed_hash() != seed_hash_) throw std::invalid_argument("B seed hash mismatch");
+    if (b.is_empty()) continue;
+    all_b_empty = false;
+    theta = std::min(theta, b.get_theta64());
+    if (b.get_num_retained() > 0) {
+      ++num_b;
+      num_b_keys += b.get_num_retained();
+      if (!b.is_ordered()) is_ordered = false;
+    }
   }
+  if (a.get_num_retained() == 0 or all_b_empty) return compact_theta_sketch_alloc<A>(a, ordered);
 
-  keys_size = a.get_num_retained();
-  keys = AllocU64().allocate(keys_size);
+  // first pass over A marks the keys to keep, so that the result can be allocated with the exact size
+  std::vector<bool, AllocBool> keep(a.get_num_retained(), false);
+  uint32_t count = 0;
 
-  if (a.is_ordered() and b.is_ordered()) { // sort-based
-    const auto end = std::set_difference(a.begin(), a.end(), b.begin(), b.end(), keys);
-    count = end - keys;
-  } else { // hash-based
-    const uint8_t lg_size = lg_size_from_count(b.get_num_retained(), update_theta_sketch_alloc<A>::REBUILD_THRESHOLD);
+  if (is_ordered) { // sort-based: A is merged with all B, which are merged using a heap
+    theta_sorted_merge_alloc<A> merge(theta, num_b);
+    for (Iterator it = first; it != last; ++it) merge.add(as_theta_sketch<A>(*it), 0);
+    uint32_t i = 0;
+    for (auto key: a) {
+      if (key >= theta) break; // early stop
+      while (!merge.is_empty() and merge.get_key() < key) merge.next();
+      if (merge.is_empty() or merge.get_key() != key) {
+        keep[i] = true;
+        ++count;
+      }
+      ++i;
+    }
+  } else { // hash-based: keys of all B go into one table
+    const uint8_t lg_size = lg_size_from_count(num_b_keys, update_theta_sketch_alloc<A>::REBUILD_THRESHOLD);
     uint64_t* b_hash_table = AllocU64().allocate(1 << lg_size);
     std::fill(b_hash_table, &b_hash_table[1 << lg_size], 0);
-    for (auto key: b) {
-      if (key < theta) {
-        update_theta_sketch_alloc<A>::hash_search_or_insert(key, b_hash_table, lg_size);
-      } else if (b.is_ordered()) {
-        break; // early stop
+    for (Iterator it = first; it != last; ++it) {
+      const theta_sketch_alloc<A>& b = as_theta_sketch<A>(*it);
+      if (b.is_empty()) continue;
+      for (auto key: b) {
+        if (key < theta) {
+          update_theta_sketch_alloc<A>::hash_search_or_insert(key, b_hash_table, lg_size);
+        } else if (b.is_ordered()) {
+          break; // early stop
+        }
       }
     }
 
     // scan A lookup B
+    uint32_t i = 0;
     for (auto key: a) {
       if (key < theta) {
-        if (!update_theta_sketch_alloc<A>::hash_search(key, b_hash_table, lg_size)) keys[count++] = key;
+        if (!update_theta_sketch_alloc<A>::hash_search(key, b_hash_table, lg_size)) {
+          keep[i] = true;
+          ++count;
+        }
       } else if (a.is_ordered()) {
         break; // early stop
       }
+      ++i;
     }
 
     AllocU64().deallocate(b_hash_table, 1 << lg_size);
   }
 
   if (count == 0) {
-    AllocU64().deallocate(keys, keys_size);
-    keys = nullptr;
-    if (theta == theta_sketch_alloc<A>::MAX_THETA) is_empty = true;
-  } else if (count < keys_size) {
-    uint64_t* keys_copy = AllocU64().allocate(count);
-    std::copy(keys, &keys[count], keys_copy);
-    AllocU64().deallocate(keys, keys_size);
-    keys = keys_copy;
-    if (ordered and !a.is_ordered()) std::sort(keys, &keys[count]);
+    const bool is_empty = theta == theta_sketch_alloc<A>::MAX_THETA;
+    return compact_theta_sketch_alloc<A>(is_empty, theta, nullptr, 0, seed_hash_, a.is_ordered() or ordered);
   }
 
-  return compact_theta_sketch_alloc<A>(is_empty, theta, keys, count, seed_hash_, a.is_ordered() or ordered);
+  uint64_t* keys = AllocU64().allocate(count);
+  uint32_t i = 0;
+  uint32_t j = 0;
+  for (auto key: a) {
+    if (keep[i++]) {
+      keys[j++] = key;
+      if (j == count) break;
+    }
+  }
+  if (ordered and !a.is_ordered()) std::sort(keys, &keys[count]);
+  return compact_theta_sketch_alloc<A>(false, theta, keys, count, seed_hash_, a.is_ordered() or ordered);
 }
 
 } /* namespace datasketches */
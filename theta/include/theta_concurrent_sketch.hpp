@@ -0,0 +1,140 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+
+#ifndef THETA_CONCURRENT_SKETCH_HPP_
+#define THETA_CONCURRENT_SKETCH_HPP_
+
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include <theta_sketch.hpp>
+
+namespace datasketches {
+
+/*
+ * Theta sketch updated from many threads at once.
+ *
+ * Each thread gets its own local_buffer, which hashes its input, drops hashes that are not below
+ * the current theta of the shared sketch, and collects the rest until the buffer is full.
+ * Full buffers are propagated as a batch into the shared sketch, either by a background thread
+ * or by the updating thread under a lock.
+ * At most MAX_QUEUED_BATCHES batches wait for the background thread; when it falls that far behind,
+ * updating threads propagate their batches themselves, so memory stays bounded.
+ * The estimate and theta are published in atomic variables after every propagation,
+ * so they can be read at any time without locking. They do not reflect updates still held
+ * in local buffers, and with background propagation also batches not yet propagated.
+ * For an exact snapshot flush all local buffers, call wait_for_propagation() and then compact().
+ */
+
+template<typename A>
+class concurrent_theta_sketch_alloc {
+public:
+  class local_buffer;
+  static const uint32_t DEFAULT_LOCAL_BUFFER_SIZE = 64;
+  static const uint32_t MAX_QUEUED_BATCHES = 64;
+
+  // the sketch provides the configuration (lg_k, p, seed and resize factor) and the initial state
+  explicit concurrent_theta_sketch_alloc(update_theta_sketch_alloc<A>&& sketch, uint32_t local_buffer_size = DEFAULT_LOCAL_BUFFER_SIZE,
+      bool background_propagation = true);
+  ~concurrent_theta_sketch_alloc();
+
+  concurrent_theta_sketch_alloc(const concurrent_theta_sketch_alloc<A>& other) = delete;
+  concurrent_theta_sketch_alloc<A>& operator=(const concurrent_theta_sketch_alloc<A>& other) = delete;
+
+  // one buffer per thread, it must not outlive this sketch
+  local_buffer get_local_buffer();
+
+  // lock-free, reflect propagated updates only
+  bool is_empty() const;
+  double get_estimate() const;
+  double get_theta() const;
+  uint64_t get_theta64() const;
+
+  // blocks until all batches flushed so far are propagated
+  void wait_for_propagation();
+
+  // snapshot of the propagated state
+  compact_theta_sketch_alloc<A> compact(bool ordered = true) const;
+
+private:
+  typedef typename std::allocator_traits<A>::template rebind_alloc<uint64_t> AllocU64;
+  typedef std::vector<uint64_t, AllocU64> vector_u64;
+  typedef typename std::allocator_traits<A>::template rebind_alloc<vector_u64> AllocVectorU64;
+
+  update_theta_sketch_alloc<A> sketch_;
+  const uint32_t local_buffer_size_;
+  mutable std::mutex sketch_mutex_;
+  std::atomic<bool> is_empty_;
+  std::atomic<uint64_t> theta_;
+  std::atomic<double> estimate_;
+
+  // background propagation
+  const bool background_propagation_;
+  std::mutex queue_mutex_;
+  std::condition_variable queue_not_empty_;
+  std::condition_variable queue_drained_;
+  std::vector<vector_u64, AllocVectorU64> queue_;
+  bool is_propagating_;
+  bool stop_;
+  std::thread propagator_;
+
+  void flush(vector_u64&& batch);
+  void propagate(const vector_u64& batch);
+  void run_propagator();
+};
+
+template<typename A>
+class concurrent_theta_sketch_alloc<A>::local_buffer: public theta_update_interface<local_buffer> {
+public:
+  local_buffer(local_buffer&& other) noexcept;
+  // flushes the remaining updates
+  ~local_buffer();
+
+  local_buffer(const local_buffer& other) = delete;
+  local_buffer& operator=(const local_buffer& other) = delete;
+
+  // same hashing as update_theta_sketch_alloc
+  using theta_update_interface<local_buffer>::update;
+  void update(const void* data, unsigned length);
+
+  // hands the collected hashes over to the shared sketch
+  void flush();
+
+private:
+  concurrent_theta_sketch_alloc<A>* sketch_;
+  vector_u64 hashes_;
+  uint64_t theta_; // cached theta of the shared sketch, refreshed on every flush
+  bool has_updates_; // updates since the last flush, possibly all filtered out
+
+  explicit local_buffer(concurrent_theta_sketch_alloc<A>& sketch);
+  friend concurrent_theta_sketch_alloc<A>;
+};
+
+// alias with default allocator for convenience
+typedef concurrent_theta_sketch_alloc<std::allocator<void>> concurrent_theta_sketch;
+
+} /* namespace datasketches */
+
+#include "theta_concurrent_sketch_impl.hpp"
+
+#endif
@@ -0,0 +1,189 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+
+#ifndef THETA_CONCURRENT_SKETCH_IMPL_HPP_
+#define THETA_CONCURRENT_SKETCH_IMPL_HPP_
+
+#include <algorithm>
+
+namespace datasketches {
+
+template<typename A>
+concurrent_theta_sketch_alloc<A>::concurrent_theta_sketch_alloc(update_theta_sketch_alloc<A>&& sketch, uint32_t local_buffer_size,
+    bool background_propagation):
+sketch_(std::move(sketch)),
+local_buffer_size_(local_buffer_size),
+is_empty_(sketch_.is_empty()),
+theta_(sketch_.get_theta64()),
+estimate_(sketch_.get_estimate()),
+background_propagation_(background_propagation),
+is_propagating_(false),
+stop_(false)
+{
+  if (local_buffer_size == 0) throw std::invalid_argument("local buffer size must be positive");
+  if (background_propagation_) propagator_ = std::thread(&concurrent_theta_sketch_alloc<A>::run_propagator, this);
+}
+
+template<typename A>
+concurrent_theta_sketch_alloc<A>::~concurrent_theta_sketch_alloc() {
+  if (background_propagation_) {
+    {
+      std::lock_guard<std::mutex> lock(queue_mutex_);
+      stop_ = true;
+    }
+    queue_not_empty_.notify_one();
+    propagator_.join();
+  }
+}
+
+template<typename A>
+typename concurrent_theta_sketch_alloc<A>::local_buffer concurrent_theta_sketch_alloc<A>::get_local_buffer() {
+  return local_buffer(*this);
+}
+
+template<typename A>
+bool concurrent_theta_sketch_alloc<A>::is_empty() const {
+  return is_empty_.load(std::memory_order_acquire);
+}
+
+template<typename A>
+double concurrent_theta_sketch_alloc<A>::get_estimate() const {
+  return estimate_.load(std::memory_order_acquire);
+}
+
+template<typename A>
+double concurrent_theta_sketch_alloc<A>::get_theta() const {
+  return static_cast<double>(get_theta64()) / theta_sketch_alloc<A>::MAX_THETA;
+}
+
+template<typename A>
+uint64_t concurrent_theta_sketch_alloc<A>::get_theta64() const {
+  return theta_.load(std::memory_order_acquire);
+}
+
+template<typename A>
+void concurrent_theta_sketch_alloc<A>::wait_for_propagation() {
+  if (!background_propagation_) return;
+  std::unique_lock<std::mutex> lock(queue_mutex_);
+  queue_drained_.wait(lock, [this] { return queue_.empty() and !is_propagating_; });
+}
+
+template<typename A>
+compact_theta_sketch_alloc<A> concurrent_theta_sketch_alloc<A>::compact(bool ordered) const {
+  std::lock_guard<std::mutex> lock(sketch_mutex_);
+  return sketch_.compact(ordered);
+}
+
+template<typename A>
+void concurrent_theta_sketch_alloc<A>::flush(vector_u64&& batch) {
+  if (background_propagation_) {
+    std::unique_lock<std::mutex> lock(queue_mutex_);
+    if (queue_.size() < MAX_QUEUED_BATCHES) {
+      queue_.push_back(std::move(batch));
+      lock.unlock();
+      queue_not_empty_.notify_one();
+      return;
+    }
+  }
+  // no background propagation, or the propagator is too far behind; batches can be applied in any order
+  propagate(batch);
+}
+
+template<typename A>
+void concurrent_theta_sketch_alloc<A>::propagate(const vector_u64& batch) {
+  typedef update_theta_sketch_alloc<A> update_sketch;
+  std::lock_guard<std::mutex> lock(sketch_mutex_);
+  sketch_.is_empty_ = false; // the batch may be empty if all updates were filtered out
+  for (size_t i = 0; i < batch.size(); i += update_sketch::BATCH_SIZE) {
+    sketch_.internal_update(&batch[i], static_cast<unsigned>(std::min(batch.size() - i, static_cast<size_t>(update_sketch::BATCH_SIZE))));
+  }
+  theta_.store(sketch_.get_theta64(), std::memory_order_release);
+  estimate_.store(sketch_.get_estimate(), std::memory_order_release);
+  is_empty_.store(false, std::memory_order_release);
+}
+
+template<typename A>
+void concurrent_theta_sketch_alloc<A>::run_propagator() {
+  std::vector<vector_u64, AllocVectorU64> batches;
+  std::unique_lock<std::mutex> lock(queue_mutex_);
+  while (true) {
+    queue_not_empty_.wait(lock, [this] { return stop_ or !queue_.empty(); });
+    if (queue_.empty()) return; // stopped and drained
+    std::swap(batches, queue_);
+    is_propagating_ = true;
+    lock.unlock();
+    for (const auto& batch: batches) propagate(batch);
+    batches.clear();
+    lock.lock();
+    is_propagating_ = false;
+    if (queue_.empty()) queue_drained_.notify_all();
+  }
+}
+
+// local buffer
+
+template<typename A>
+concurrent_theta_sketch_alloc<A>::local_buffer::local_buffer(concurrent_theta_sketch_alloc<A>& sketch):
+sketch_(&sketch),
+hashes_(),
+theta_(sketch.get_theta64()),
+has_updates_(false)
+{
+  hashes_.reserve(sketch.local_buffer_size_);
+}
+
+template<typename A>
+concurrent_theta_sketch_alloc<A>::local_buffer::local_buffer(local_buffer&& other) noexcept:
+sketch_(other.sketch_),
+hashes_(std::move(other.hashes_)),
+theta_(other.theta_),
+has_updates_(other.has_updates_)
+{
+  other.sketch_ = nullptr;
+}
+
+template<typename A>
+concurrent_theta_sketch_alloc<A>::local_buffer::~local_buffer() {
+  if (sketch_ != nullptr) flush();
+}
+
+template<typename A>
+void concurrent_theta_sketch_alloc<A>::local_buffer::update(const void* data, unsigned length) {
+  const uint64_t hash = sketch_->sketch_.compute_hash(data, length);
+  has_updates_ = true;
+  if (hash >= theta_ or hash == 0) return; // hash == 0 is reserved to mark empty slots in the table
+  hashes_.push_back(hash);
+  if (hashes_.size() == sketch_->local_buffer_size_) flush();
+}
+
+template<typename A>
+void concurrent_theta_sketch_alloc<A>::local_buffer::flush() {
+  if (!has_updates_) return;
+  vector_u64 batch;
+  batch.reserve(sketch_->local_buffer_size_);
+  std::swap(batch, hashes_);
+  sketch_->flush(std::move(batch));
+  has_updates_ = false;
+  theta_ = sketch_->get_theta64();
+}
+
+} /* namespace datasketches */
+
+#endif
@@ -0,0 +1,97 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+#ifndef THETA_EXPRESSION_HPP_
+#define THETA_EXPRESSION_HPP_
+
+#include <memory>
+#include <functional>
+#include <climits>
+#include <vector>
+
+#include <theta_sketch.hpp>
+#include <theta_sorted_merge.hpp>
+
+namespace datasketches {
+
+/*
+ * Evaluates a set expression over many theta sketches in one pass,
+ * for example (A union B) intersection (C minus D), without computing intermediate sketches.
+ * The expression is built bottom-up: each method adding a node returns its id
+ * to be used as an operand of the following nodes.
+ * All sketches must outlive the computation.
+ *
+ * The result is ordered. It uses the minimum theta of all non-empty sketches in the expression,
+ * and retains every hash below it that satisfies the expression.
+ * UNION nodes are exact: unlike theta_union_alloc they are not limited to a nominal number
+ * of entries, so A union B retains more hashes, with a larger theta, than theta_union_alloc
+ * gives for the same sketches once that exceeds its nominal size. Both estimate the same
+ * cardinality; use theta_union_alloc where the result must match it.
+ */
+
+template<typename A>
+class theta_expression_alloc {
+public:
+  typedef uint32_t node_id;
+  typedef typename std::allocator_traits<A>::template rebind_alloc<node_id> AllocNodeId;
+  typedef std::vector<node_id, AllocNodeId> node_ids;
+
+  explicit theta_expression_alloc(uint64_t seed = update_theta_sketch_alloc<A>::builder::DEFAULT_SEED);
+
+  node_id add_sketch(const theta_sketch_alloc<A>& sketch);
+  // exact union of the operands below theta, not capped at a nominal size
+  node_id add_union(const node_ids& operands);
+  node_id add_intersection(const node_ids& operands);
+  node_id add_a_not_b(node_id a, node_id b);
+
+  compact_theta_sketch_alloc<A> compute(node_id root) const;
+
+private:
+  typedef typename std::allocator_traits<A>::template rebind_alloc<uint64_t> AllocU64;
+  typedef typename std::allocator_traits<A>::template rebind_alloc<bool> AllocBool;
+
+  enum node_type { SKETCH, UNION, INTERSECTION, A_NOT_B };
+  struct node {
+    node_type type;
+    uint32_t first; // index of the sketch for SKETCH, index of the first operand in operands_ otherwise
+    uint32_t num_operands;
+  };
+  typedef typename std::allocator_traits<A>::template rebind_alloc<node> AllocNode;
+  typedef typename std::allocator_traits<A>::template rebind_alloc<const theta_sketch_alloc<A>*> AllocSketchPtr;
+
+  uint16_t seed_hash_;
+  std::vector<node, AllocNode> nodes_;
+  node_ids operands_;
+  std::vector<const theta_sketch_alloc<A>*, AllocSketchPtr> sketches_;
+
+  node_id add_operation(node_type type, const node_ids& operands);
+  void check_node_id(node_id id) const;
+  void mark_sketches(node_id id, std::vector<bool, AllocBool>& marks) const;
+  bool is_empty(node_id id) const;
+  bool evaluate(node_id id, const std::vector<bool, AllocBool>& membership) const;
+};
+
+// alias with default allocator for convenience
+typedef theta_expression_alloc<std::allocator<void>> theta_expression;
+
+} /* namespace datasketches */
+
+#include "theta_expression_impl.hpp"
+
+# endif
@@ -0,0 +1,176 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+#ifndef THETA_EXPRESSION_IMPL_HPP_
+#define THETA_EXPRESSION_IMPL_HPP_
+
+#include <algorithm>
+#include <functional>
+#include <vector>
+
+namespace datasketches {
+
+template<typename A>
+theta_expression_alloc<A>::theta_expression_alloc(uint64_t seed):
+seed_hash_(theta_sketch_alloc<A>::get_seed_hash(seed))
+{}
+
+template<typename A>
+typename theta_expression_alloc<A>::node_id theta_expression_alloc<A>::add_sketch(const theta_sketch_alloc<A>& sketch) {
+  if (!sketch.is_empty() and sketch.get_seed_hash() != seed_hash_) throw std::invalid_argument("seed hash mismatch");
+  nodes_.push_back(node { SKETCH, static_cast<uint32_t>(sketches_.size()), 0 });
+  sketches_.push_back(&sketch);
+  return nodes_.size() - 1;
+}
+
+template<typename A>
+typename theta_expression_alloc<A>::node_id theta_expression_alloc<A>::add_union(const node_ids& operands) {
+  return add_operation(UNION, operands);
+}
+
+template<typename A>
+typename theta_expression_alloc<A>::node_id theta_expression_alloc<A>::add_intersection(const node_ids& operands) {
+  return add_operation(INTERSECTION, operands);
+}
+
+template<typename A>
+typename theta_expression_alloc<A>::node_id theta_expression_alloc<A>::add_a_not_b(node_id a, node_id b) {
+  return add_operation(A_NOT_B, node_ids({a, b}));
+}
+
+template<typename A>
+typename theta_expression_alloc<A>::node_id theta_expression_alloc<A>::add_operation(node_type type, const node_ids& operands) {
+  if (operands.empty()) throw std::invalid_argument("no operands");
+  for (node_id id: operands) check_node_id(id);
+  nodes_.push_back(node { type, static_cast<uint32_t>(operands_.size()), static_cast<uint32_t>(operands.size()) });
+  operands_.insert(operands_.end(), operands.begin(), operands.end());
+  return nodes_.size() - 1;
+}
+
+template<typename A>
+void theta_expression_alloc<A>::check_node_id(node_id id) const {
+  if (id >= nodes_.size()) throw std::invalid_argument("invalid node id " + std::to_string(id));
+}
+
+template<typename A>
+compact_theta_sketch_alloc<A> theta_expression_alloc<A>::compute(node_id root) const {
+  typedef typename std::allocator_traits<A>::template rebind_alloc<uint32_t> AllocU32;
+
+  check_node_id(root);
+  std::vector<bool, AllocBool> is_used(sketches_.size(), false);
+  mark_sketches(root, is_used);
+
+  uint64_t theta = theta_sketch_alloc<A>::MAX_THETA;
+  uint32_t num_used = 0;
+  for (uint32_t i = 0; i < sketches_.size(); i++) {
+    if (!is_used[i] or sketches_[i]->is_empty()) continue;
+    theta = std::min(theta, sketches_[i]->get_theta64());
+    ++num_used;
+  }
+  const bool is_empty = this->is_empty(root);
+  if (is_empty) return compact_theta_sketch_alloc<A>(true, theta, nullptr, 0, seed_hash_, true);
+
+  // all sketches are traversed in order at once, so that for every hash below theta
+  // the set of sketches containing it is known, and the expression is evaluated on that set
+  theta_sorted_merge_alloc<A> merge(theta, num_used);
+  for (uint32_t i = 0; i < sketches_.size(); i++) {
+    if (is_used[i]) merge.add(*sketches_[i], i);
+  }
+
+  std::vector<bool, AllocBool> membership(sketches_.size(), false);
+  std::vector<uint32_t, AllocU32> members;
+  std::vector<uint64_t, AllocU64> keys;
+  while (!merge.is_empty()) {
+    const uint64_t key = merge.get_key();
+    while (!merge.is_empty() and merge.get_key() == key) {
+      const uint32_t i = merge.get_id();
+      membership[i] = true;
+      members.push_back(i);
+      merge.next();
+    }
+    if (evaluate(root, membership)) keys.push_back(key);
+    for (uint32_t i: members) membership[i] = false;
+    members.clear();
+  }
+
+  if (keys.empty()) {
+    return compact_theta_sketch_alloc<A>(theta == theta_sketch_alloc<A>::MAX_THETA, theta, nullptr, 0, seed_hash_, true);
+  }
+  uint64_t* result_keys = AllocU64().allocate(keys.size());
+  std::copy(keys.begin(), keys.end(), result_keys);
+  return compact_theta_sketch_alloc<A>(false, theta, result_keys, keys.size(), seed_hash_, true);
+}
+
+template<typename A>
+void theta_expression_alloc<A>::mark_sketches(node_id id, std::vector<bool, AllocBool>& marks) const {
+  const node& n = nodes_[id];
+  if (n.type == SKETCH) {
+    marks[n.first] = true;
+  } else {
+    for (uint32_t i = n.first; i < n.first + n.num_operands; i++) mark_sketches(operands_[i], marks);
+  }
+}
+
+template<typename A>
+bool theta_expression_alloc<A>::is_empty(node_id id) const {
+  const node& n = nodes_[id];
+  switch (n.type) {
+    case SKETCH:
+      return sketches_[n.first]->is_empty();
+    case UNION:
+      for (uint32_t i = n.first; i < n.first + n.num_operands; i++) {
+        if (!is_empty(operands_[i])) return false;
+      }
+      return true;
+    case INTERSECTION:
+      for (uint32_t i = n.first; i < n.first + n.num_operands; i++) {
+        if (is_empty(operands_[i])) return true;
+      }
+      return false;
+    case A_NOT_B:
+      return is_empty(operands_[n.first]);
+  }
+  return false;
+}
+
+template<typename A>
+bool theta_expression_alloc<A>::evaluate(node_id id, const std::vector<bool, AllocBool>& membership) const {
+  const node& n = nodes_[id];
+  switch (n.type) {
+    case SKETCH:
+      return membership[n.first];
+    case UNION:
+      for (uint32_t i = n.first; i < n.first + n.num_operands; i++) {
+        if (evaluate(operands_[i], membership)) return true;
+      }
+      return false;
+    case INTERSECTION:
+      for (uint32_t i = n.first; i < n.first + n.num_operands; i++) {
+        if (!evaluate(operands_[i], membership)) return false;
+      }
+      return true;
+    case A_NOT_B:
+      return evaluate(operands_[n.first], membership) and !evaluate(operands_[n.first + 1], membership);
+  }
+  return false;
+}
+
+} /* namespace datasketches */
+
+# endif
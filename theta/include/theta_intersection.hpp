@@ -34,9 +34,24 @@ namespace datasketches {
  * author Kevin Lang
  */
 
+template<typename A> class theta_jaccard_similarity_alloc;
+
 template<typename A>
 class theta_intersection_alloc {
 public:
+  // what the estimate and bounds of an intersection depend on, available without materializing the keys
+  struct summary {
+    bool is_empty;
+    uint64_t theta;
+    uint32_t num_keys;
+
+    bool is_estimation_mode() const;
+    double get_theta() const;
+    double get_estimate() const;
+    double get_lower_bound(uint8_t num_std_devs) const;
+    double get_upper_bound(uint8_t num_std_devs) const;
+  };
+
   explicit theta_intersection_alloc(uint64_t seed = update_theta_sketch_alloc<A>::builder::DEFAULT_SEED);
   theta_intersection_alloc(const theta_intersection_alloc<A>& other);
   theta_intersection_alloc(theta_intersection_alloc<A>&& other) noexcept;
@@ -47,17 +62,53 @@ public:
 
   void update(const theta_sketch_alloc<A>& sketch);
   compact_theta_sketch_alloc<A> get_result(bool ordered = true) const;
+
+  // Writes the result into a caller-supplied 8-byte aligned buffer in the serialized compact format,
+  // which can be used in place by wrapped_compact_theta_sketch_alloc::wrap() without allocation.
+  // The buffer must have at least get_max_result_size_bytes() bytes.
+  // Returns the number of bytes written.
+  size_t get_result(void* bytes, size_t size, bool ordered = true) const;
+  size_t get_max_result_size_bytes() const;
+
   bool has_result() const;
 
+  // same as the estimate and bounds of get_result() without allocating the result
+  summary get_summary() const;
+
+  // Intersection of two sketches without allocation, unless both sketches are unordered
+  // (keys of the ordered side are found by merge or binary search).
+  // Equivalent to updating a new intersection with both sketches and calling get_summary().
+  static summary get_summary(const theta_sketch_alloc<A>& a, const theta_sketch_alloc<A>& b);
+
+  // returns to the initial state, keeping the allocated keys for reuse by subsequent updates
+  void reset();
+
 private:
   typedef typename std::allocator_traits<A>::template rebind_alloc<uint64_t> AllocU64;
+
+  // galloping search is used if one side has at least this many times more keys than the other
+  static const uint32_t GALLOPING_RATIO = 8;
+
   bool is_valid_;
   bool is_empty_;
+  // while all incoming sketches are ordered, the keys are kept as a sorted array
+  // instead of a hash table, and intersected by merge or galloping search
+  bool is_ordered_;
   uint64_t theta_;
   uint8_t lg_size_;
+  uint8_t lg_capacity_; // size of the allocated keys, might be larger than the one in use
   uint64_t* keys_;
   uint32_t num_keys_;
   uint16_t seed_hash_;
+
+  void reserve(uint8_t lg_size);
+  void update_ordered(const theta_sketch_alloc<A>& sketch);
+  void convert_to_hash_table();
+  // out can be null to count the matches only
+  static uint32_t intersect_sorted(const uint64_t* small, uint32_t small_size, const uint64_t* large, uint32_t large_size, uint64_t* out);
+  static uint32_t count_matches(const theta_sketch_alloc<A>& a, const theta_sketch_alloc<A>& b, uint64_t theta);
+
+  friend theta_jaccard_similarity_alloc<A>;
 };
 
 // alias with default allocator for convenience
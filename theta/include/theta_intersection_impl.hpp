@@ -34,8 +34,10 @@ template<typename A>
 theta_intersection_alloc<A>::theta_intersection_alloc(uint64_t seed):
 is_valid_(false),
 is_empty_(false),
+is_ordered_(false),
 theta_(theta_sketch_alloc<A>::MAX_THETA),
 lg_size_(0),
+lg_capacity_(0),
 keys_(nullptr),
 num_keys_(0),
 seed_hash_(theta_sketch_alloc<A>::get_seed_hash(seed))
@@ -45,29 +47,35 @@ template<typename A>
 theta_intersection_alloc<A>::theta_intersection_alloc(const theta_intersection_alloc<A>& other):
 is_valid_(other.is_valid_),
 is_empty_(other.is_empty_),
+is_ordered_(other.is_ordered_),
 theta_(other.theta_),
 lg_size_(other.lg_size_),
+lg_capacity_(other.keys_ == nullptr ? 0 : other.lg_size_),
 keys_(other.keys_ == nullptr ? nullptr : AllocU64().allocate(1 << lg_size_)),
 num_keys_(other.num_keys_),
 seed_hash_(other.seed_hash_)
 {
-  if (keys_ != nullptr) std::copy(other.keys_, &other.keys_[1 << lg_size_], keys_);
+  if (keys_ != nullptr) std::copy(other.keys_, &other.keys_[is_ordered_ ? num_keys_ : 1 << lg_size_], keys_);
 }
 
 template<typename A>
 theta_intersection_alloc<A>::theta_intersection_alloc(theta_intersection_alloc<A>&& other) noexcept:
 is_valid_(false),
 is_empty_(false),
+is_ordered_(false),
 theta_(theta_sketch_alloc<A>::MAX_THETA),
 lg_size_(0),
+lg_capacity_(0),
 keys_(nullptr),
 num_keys_(0),
 seed_hash_(other.seed_hash_)
 {
   std::swap(is_valid_, other.is_valid_);
   std::swap(is_empty_, other.is_empty_);
+  std::swap(is_ordered_, other.is_ordered_);
   std::swap(theta_, other.theta_);
   std::swap(lg_size_, other.lg_size_);
+  std::swap(lg_capacity_, other.lg_capacity_);
   std::swap(keys_, other.keys_);
   std::swap(num_keys_, other.num_keys_);
 }
@@ -75,7 +83,7 @@ seed_hash_(other.seed_hash_)
 template<typename A>
 theta_intersection_alloc<A>::~theta_intersection_alloc() {
   if (keys_ != nullptr) {
-    AllocU64().deallocate(keys_, 1 << lg_size_);
+    AllocU64().deallocate(keys_, 1 << lg_capacity_);
   }
 }
 
@@ -83,8 +91,10 @@ template<typename A>
 theta_intersection_alloc<A>& theta_intersection_alloc<A>::operator=(theta_intersection_alloc<A> other) {
   std::swap(is_valid_, other.is_valid_);
   std::swap(is_empty_, other.is_empty_);
+  std::swap(is_ordered_, other.is_ordered_);
   std::swap(theta_, other.theta_);
   std::swap(lg_size_, other.lg_size_);
+  std::swap(lg_capacity_, other.lg_capacity_);
   std::swap(keys_, other.keys_);
   std::swap(num_keys_, other.num_keys_);
   std::swap(seed_hash_, other.seed_hash_);
@@ -95,8 +105,10 @@ template<typename A>
 theta_intersection_alloc<A>& theta_intersection_alloc<A>::operator=(theta_intersection_alloc<A>&& other) {
   std::swap(is_valid_, other.is_valid_);
   std::swap(is_empty_, other.is_empty_);
+  std::swap(is_ordered_, other.is_ordered_);
   std::swap(theta_, other.theta_);
   std::swap(lg_size_, other.lg_size_);
+  std::swap(lg_capacity_, other.lg_capacity_);
   std::swap(keys_, other.keys_);
   std::swap(num_keys_, other.num_keys_);
   std::swap(seed_hash_, other.seed_hash_);
@@ -112,18 +124,24 @@ void theta_intersection_alloc<A>::update(const theta_sketch_alloc<A>& sketch) {
   if (is_valid_ and num_keys_ == 0) return;
   if (sketch.get_num_retained() == 0) {
     is_valid_ = true;
-    if (keys_ != nullptr) {
-      AllocU64().deallocate(keys_, 1 << lg_size_);
-      keys_ = nullptr;
-      lg_size_ = 0;
-      num_keys_ = 0;
-    }
+    num_keys_ = 0;
     return;
   }
-  if (!is_valid_) { // first update, clone incoming sketch
+  if (!is_valid_ and sketch.is_ordered()) { // first update, copy incoming sorted keys
+    is_valid_ = true;
+    is_ordered_ = true;
+    reserve(lg_size_from_count(sketch.get_num_retained(), 1));
+    uint64_t previous_key = 0;
+    for (auto key: sketch) {
+      if (key <= previous_key) throw std::invalid_argument("unordered or duplicate key, possibly corrupted input sketch");
+      if (num_keys_ == sketch.get_num_retained()) throw std::invalid_argument("more keys then expected, possibly corrupted input sketch");
+      keys_[num_keys_++] = key;
+      previous_key = key;
+    }
+    if (num_keys_ != sketch.get_num_retained()) throw std::invalid_argument("num keys mismatch, possibly corrupted input sketch");
+  } else if (!is_valid_) { // first update, clone incoming sketch
     is_valid_ = true;
-    lg_size_ = lg_size_from_count(sketch.get_num_retained(), update_theta_sketch_alloc<A>::REBUILD_THRESHOLD);
-    keys_ = AllocU64().allocate(1 << lg_size_);
+    reserve(lg_size_from_count(sketch.get_num_retained(), update_theta_sketch_alloc<A>::REBUILD_THRESHOLD));
     std::fill(keys_, &keys_[1 << lg_size_], 0);
     for (auto key: sketch) {
       if (!update_theta_sketch_alloc<A>::hash_search_or_insert(key, keys_, lg_size_)) {
@@ -132,7 +150,10 @@ void theta_intersection_alloc<A>::update(const theta_sketch_alloc<A>& sketch) {
       ++num_keys_;
     }
     if (num_keys_ != sketch.get_num_retained()) throw std::invalid_argument("num keys mismatch, possibly corrupted input sketch");
+  } else if (is_ordered_ and sketch.is_ordered()) {
+    update_ordered(sketch);
   } else { // intersection
+    if (is_ordered_) convert_to_hash_table();
     const uint32_t max_matches = std::min(num_keys_, sketch.get_num_retained());
     uint64_t* matched_keys = AllocU64().allocate(max_matches);
     uint32_t match_count = 0;
@@ -154,18 +175,10 @@ void theta_intersection_alloc<A>::update(const theta_sketch_alloc<A>& sketch) {
       throw std::invalid_argument(" fewer keys then expected, possibly corrupted input sketch");
     }
     if (match_count == 0) {
-      AllocU64().deallocate(keys_, 1 << lg_size_);
-      keys_ = nullptr;
-      lg_size_ = 0;
       num_keys_ = 0;
       if (theta_ == theta_sketch_alloc<A>::MAX_THETA) is_empty_ = true;
     } else {
-      const uint8_t lg_size = lg_size_from_count(match_count, update_theta_sketch_alloc<A>::REBUILD_THRESHOLD);
-      if (lg_size != lg_size_) {
-        AllocU64().deallocate(keys_, 1 << lg_size_);
-        lg_size_ = lg_size;
-        keys_ = AllocU64().allocate(1 << lg_size_);
-      }
+      reserve(lg_size_from_count(match_count, update_theta_sketch_alloc<A>::REBUILD_THRESHOLD));
       std::fill(keys_, &keys_[1 << lg_size_], 0);
       for (uint32_t i = 0; i < match_count; i++) {
         update_theta_sketch_alloc<A>::hash_search_or_insert(matched_keys[i], keys_, lg_size_);
@@ -176,21 +189,233 @@ void theta_intersection_alloc<A>::update(const theta_sketch_alloc<A>& sketch) {
   }
 }
 
+template<typename A>
+void theta_intersection_alloc<A>::update_ordered(const theta_sketch_alloc<A>& sketch) {
+  // ordered sketches are compact, so their keys are stored contiguously
+  const uint64_t* sketch_keys = sketch.get_keys();
+  const uint32_t sketch_size = std::lower_bound(sketch_keys, &sketch_keys[sketch.get_num_retained()], theta_) - sketch_keys;
+  const uint32_t size = std::lower_bound(keys_, &keys_[num_keys_], theta_) - keys_;
+
+  // the matches are written over the retained keys, which is safe since they are a subsequence of them
+  uint32_t match_count = 0;
+  if (size <= sketch_size) {
+    match_count = intersect_sorted(keys_, size, sketch_keys, sketch_size, keys_);
+  } else {
+    match_count = intersect_sorted(sketch_keys, sketch_size, keys_, size, keys_);
+  }
+
+  if (match_count == 0 and theta_ == theta_sketch_alloc<A>::MAX_THETA) is_empty_ = true;
+  num_keys_ = match_count;
+}
+
+template<typename A>
+void theta_intersection_alloc<A>::reserve(uint8_t lg_size) {
+  if (keys_ == nullptr or lg_capacity_ < lg_size) {
+    if (keys_ != nullptr) AllocU64().deallocate(keys_, 1 << lg_capacity_);
+    keys_ = AllocU64().allocate(1 << lg_size);
+    lg_capacity_ = lg_size;
+  }
+  lg_size_ = lg_size;
+}
+
+template<typename A>
+uint32_t theta_intersection_alloc<A>::intersect_sorted(const uint64_t* small, uint32_t small_size, const uint64_t* large, uint32_t large_size, uint64_t* out) {
+  uint32_t count = 0;
+  if (small_size == 0) return count;
+  if (large_size / small_size < GALLOPING_RATIO and out == nullptr) { // branchless merge, counting only
+    uint32_t i = 0;
+    uint32_t j = 0;
+    while (i < small_size and j < large_size) {
+      const uint64_t x = small[i];
+      const uint64_t y = large[j];
+      count += x == y;
+      i += x <= y;
+      j += y <= x;
+    }
+  } else if (large_size / small_size < GALLOPING_RATIO) { // merge into out, which may overlap the input
+    uint32_t i = 0;
+    uint32_t j = 0;
+    while (i < small_size and j < large_size) {
+      if (small[i] < large[j]) {
+        ++i;
+      } else if (large[j] < small[i]) {
+        ++j;
+      } else {
+        out[count++] = small[i];
+        ++i;
+        ++j;
+      }
+    }
+  } else { // galloping search in the large side
+    uint32_t pos = 0;
+    for (uint32_t i = 0; i < small_size; i++) {
+      const uint64_t key = small[i];
+      uint32_t bound = 1;
+      while (pos + bound < large_size and large[pos + bound] < key) bound <<= 1;
+      pos = std::lower_bound(&large[pos + bound / 2], &large[std::min(pos + bound + 1, large_size)], key) - large;
+      if (pos == large_size) break;
+      if (large[pos] == key) {
+        if (out != nullptr) out[count] = key;
+        ++count;
+        ++pos;
+      }
+    }
+  }
+  return count;
+}
+
+template<typename A>
+void theta_intersection_alloc<A>::convert_to_hash_table() {
+  const uint8_t lg_size = lg_size_from_count(num_keys_, update_theta_sketch_alloc<A>::REBUILD_THRESHOLD);
+  uint64_t* keys = AllocU64().allocate(1 << lg_size);
+  std::fill(keys, &keys[1 << lg_size], 0);
+  for (uint32_t i = 0; i < num_keys_; i++) {
+    update_theta_sketch_alloc<A>::hash_insert(keys_[i], keys, lg_size);
+  }
+  AllocU64().deallocate(keys_, 1 << lg_capacity_);
+  keys_ = keys;
+  lg_size_ = lg_size;
+  lg_capacity_ = lg_size;
+  is_ordered_ = false;
+}
+
 template<typename A>
 compact_theta_sketch_alloc<A> theta_intersection_alloc<A>::get_result(bool ordered) const {
   if (!is_valid_) throw std::invalid_argument("calling get_result() before calling update() is undefined");
   if (num_keys_ == 0) return compact_theta_sketch_alloc<A>(is_empty_, theta_, nullptr, 0, seed_hash_, ordered);
   uint64_t* keys = AllocU64().allocate(num_keys_);
+  if (is_ordered_) {
+    std::copy(keys_, &keys_[num_keys_], keys);
+    return compact_theta_sketch_alloc<A>(false, this->theta_, keys, num_keys_, seed_hash_, true);
+  }
   std::copy_if(keys_, &keys_[1 << lg_size_], keys, [](uint64_t key) { return key != 0; });
   if (ordered) std::sort(keys, &keys[num_keys_]);
   return compact_theta_sketch_alloc<A>(false, this->theta_, keys, num_keys_, seed_hash_, ordered);
 }
 
+template<typename A>
+size_t theta_intersection_alloc<A>::get_result(void* bytes, size_t size, bool ordered) const {
+  if (!is_valid_) throw std::invalid_argument("calling get_result() before calling update() is undefined");
+  if (size < get_max_result_size_bytes()) throw std::invalid_argument("buffer too small");
+  if (reinterpret_cast<uintptr_t>(bytes) % alignof(uint64_t) != 0) throw std::invalid_argument("buffer is not 8-byte aligned");
+  uint8_t* ptr = static_cast<uint8_t*>(bytes);
+  uint64_t* keys = reinterpret_cast<uint64_t*>(ptr + compact_theta_sketch_alloc<A>::MAX_PREAMBLE_BYTES);
+  if (num_keys_ > 0) {
+    if (is_ordered_) {
+      std::copy(keys_, &keys_[num_keys_], keys);
+      ordered = true;
+    } else {
+      std::copy_if(keys_, &keys_[1 << lg_size_], keys, [](uint64_t key) { return key != 0; });
+      if (ordered) std::sort(keys, &keys[num_keys_]);
+    }
+  }
+  return compact_theta_sketch_alloc<A>::serialize_in_place(ptr, is_empty_, theta_, num_keys_, seed_hash_, ordered);
+}
+
+template<typename A>
+size_t theta_intersection_alloc<A>::get_max_result_size_bytes() const {
+  return compact_theta_sketch_alloc<A>::MAX_PREAMBLE_BYTES + sizeof(uint64_t) * num_keys_;
+}
+
 template<typename A>
 bool theta_intersection_alloc<A>::has_result() const {
   return is_valid_;
 }
 
+template<typename A>
+typename theta_intersection_alloc<A>::summary theta_intersection_alloc<A>::get_summary() const {
+  if (!is_valid_) throw std::invalid_argument("calling get_summary() before calling update() is undefined");
+  return summary { is_empty_, theta_, num_keys_ };
+}
+
+template<typename A>
+typename theta_intersection_alloc<A>::summary theta_intersection_alloc<A>::get_summary(const theta_sketch_alloc<A>& a, const theta_sketch_alloc<A>& b) {
+  if (a.get_seed_hash() != b.get_seed_hash()) throw std::invalid_argument("seed hash mismatch");
+  // follows the updates of an intersection with a and then b
+  if (a.is_empty()) return summary { true, a.get_theta64(), 0 };
+  const uint64_t theta = std::min(a.get_theta64(), b.get_theta64());
+  if (a.get_num_retained() == 0 or b.get_num_retained() == 0) return summary { b.is_empty(), theta, 0 };
+  const uint32_t num_keys = count_matches(a, b, theta);
+  return summary { num_keys == 0 and theta == theta_sketch_alloc<A>::MAX_THETA, theta, num_keys };
+}
+
+template<typename A>
+uint32_t theta_intersection_alloc<A>::count_matches(const theta_sketch_alloc<A>& a, const theta_sketch_alloc<A>& b, uint64_t theta) {
+  if (a.is_ordered() and b.is_ordered()) {
+    // ordered sketches are compact, so their keys are stored contiguously
+    const uint64_t* keys_a = a.get_keys();
+    const uint32_t size_a = std::lower_bound(keys_a, &keys_a[a.get_num_retained()], theta) - keys_a;
+    const uint64_t* keys_b = b.get_keys();
+    const uint32_t size_b = std::lower_bound(keys_b, &keys_b[b.get_num_retained()], theta) - keys_b;
+    if (size_a <= size_b) return intersect_sorted(keys_a, size_a, keys_b, size_b, nullptr);
+    return intersect_sorted(keys_b, size_b, keys_a, size_a, nullptr);
+  }
+  if (a.is_ordered() or b.is_ordered()) {
+    const theta_sketch_alloc<A>& ordered = a.is_ordered() ? a : b;
+    const theta_sketch_alloc<A>& unordered = a.is_ordered() ? b : a;
+    const uint64_t* keys = ordered.get_keys();
+    const uint64_t* keys_end = std::lower_bound(keys, &keys[ordered.get_num_retained()], theta);
+    uint32_t count = 0;
+    for (auto key: unordered) {
+      if (key < theta and std::binary_search(keys, keys_end, key)) ++count;
+    }
+    return count;
+  }
+  // both unordered, a temporary hash table of the smaller side is needed
+  const theta_sketch_alloc<A>& small = a.get_num_retained() <= b.get_num_retained() ? a : b;
+  const theta_sketch_alloc<A>& large = a.get_num_retained() <= b.get_num_retained() ? b : a;
+  const uint8_t lg_size = lg_size_from_count(small.get_num_retained(), update_theta_sketch_alloc<A>::REBUILD_THRESHOLD);
+  uint64_t* table = AllocU64().allocate(1 << lg_size);
+  std::fill(table, &table[1 << lg_size], 0);
+  for (auto key: small) {
+    if (key < theta) update_theta_sketch_alloc<A>::hash_search_or_insert(key, table, lg_size);
+  }
+  uint32_t count = 0;
+  for (auto key: large) {
+    if (key < theta and update_theta_sketch_alloc<A>::hash_search(key, table, lg_size)) ++count;
+  }
+  AllocU64().deallocate(table, 1 << lg_size);
+  return count;
+}
+
+// summary
+
+template<typename A>
+bool theta_intersection_alloc<A>::summary::is_estimation_mode() const {
+  return theta < theta_sketch_alloc<A>::MAX_THETA and !is_empty;
+}
+
+template<typename A>
+double theta_intersection_alloc<A>::summary::get_theta() const {
+  return static_cast<double>(theta) / theta_sketch_alloc<A>::MAX_THETA;
+}
+
+template<typename A>
+double theta_intersection_alloc<A>::summary::get_estimate() const {
+  return num_keys / get_theta();
+}
+
+template<typename A>
+double theta_intersection_alloc<A>::summary::get_lower_bound(uint8_t num_std_devs) const {
+  if (!is_estimation_mode()) return num_keys;
+  return binomial_bounds::get_lower_bound(num_keys, get_theta(), num_std_devs);
+}
+
+template<typename A>
+double theta_intersection_alloc<A>::summary::get_upper_bound(uint8_t num_std_devs) const {
+  if (!is_estimation_mode()) return num_keys;
+  return binomial_bounds::get_upper_bound(num_keys, get_theta(), num_std_devs);
+}
+
+template<typename A>
+void theta_intersection_alloc<A>::reset() {
+  is_valid_ = false;
+  is_empty_ = false;
+  is_ordered_ = false;
+  theta_ = theta_sketch_alloc<A>::MAX_THETA;
+  num_keys_ = 0;
+}
+
 } /* namespace datasketches */
 
 # endif
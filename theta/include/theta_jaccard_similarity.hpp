@@ -0,0 +1,90 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+
+#ifndef THETA_JACCARD_SIMILARITY_HPP_
+#define THETA_JACCARD_SIMILARITY_HPP_
+
+#include <memory>
+#include <vector>
+
+#include <theta_sketch.hpp>
+#include <theta_intersection.hpp>
+
+namespace datasketches {
+
+/*
+ * Jaccard similarity |A intersection B| / |A union B| of theta sketches.
+ * Both counts are taken over the retained hashes below the minimum theta of the pair,
+ * so the ratio is estimated from the same sampled set and bounded as a binomial proportion
+ * (2 standard deviations, as in the Java JaccardSimilarity).
+ *
+ * jaccard_matrix() computes all pairs of a range of sketches at once:
+ * the keys of every sketch are copied and sorted once into a shared contiguous pool,
+ * and the upper triangle of the matrix is processed in square tiles of sketches,
+ * so that the keys of a tile stay in cache, optionally spread over several threads.
+ */
+
+template<typename A>
+class theta_jaccard_similarity_alloc {
+public:
+  struct similarity {
+    double lower_bound;
+    double estimate;
+    double upper_bound;
+    double intersection_estimate; // cardinality of the intersection
+  };
+  typedef typename std::allocator_traits<A>::template rebind_alloc<similarity> AllocSimilarity;
+  typedef std::vector<similarity, AllocSimilarity> matrix; // row-major N x N
+
+  static similarity jaccard(const theta_sketch_alloc<A>& a, const theta_sketch_alloc<A>& b);
+
+  // range of sketches or pointers to sketches, all with the same seed
+  // num_threads = 0 means std::thread::hardware_concurrency()
+  template<typename Iterator>
+  static matrix jaccard_matrix(Iterator first, Iterator last, unsigned num_threads = 1);
+
+private:
+  static const uint32_t BLOCK_SIZE = 32; // sketches per side of a tile
+  static const unsigned NUM_STD_DEVS = 2;
+
+  typedef typename std::allocator_traits<A>::template rebind_alloc<uint64_t> AllocU64;
+  typedef std::vector<uint64_t, AllocU64> vector_u64;
+
+  struct sorted_keys {
+    size_t offset; // in the pool
+    uint32_t num_keys;
+    uint64_t theta;
+    bool is_empty;
+  };
+  typedef typename std::allocator_traits<A>::template rebind_alloc<sorted_keys> AllocSortedKeys;
+  typedef std::vector<sorted_keys, AllocSortedKeys> vector_sorted_keys;
+
+  static void add_sketch(const theta_sketch_alloc<A>& sketch, vector_u64& pool, vector_sorted_keys& sketches);
+  static similarity compute(const uint64_t* pool, const sorted_keys& a, const sorted_keys& b);
+};
+
+// alias with default allocator for convenience
+typedef theta_jaccard_similarity_alloc<std::allocator<void>> theta_jaccard_similarity;
+
+} /* namespace datasketches */
+
+#include "theta_jaccard_similarity_impl.hpp"
+
+#endif
@@ -0,0 +1,134 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+
+#ifndef THETA_JACCARD_SIMILARITY_IMPL_HPP_
+#define THETA_JACCARD_SIMILARITY_IMPL_HPP_
+
+#include <algorithm>
+#include <atomic>
+#include <thread>
+#include <utility>
+
+#include "bounds_binomial_proportions.hpp"
+
+namespace datasketches {
+
+template<typename A>
+typename theta_jaccard_similarity_alloc<A>::similarity theta_jaccard_similarity_alloc<A>::jaccard(const theta_sketch_alloc<A>& a, const theta_sketch_alloc<A>& b) {
+  if (&a == &b) return similarity { 1, 1, 1, a.get_estimate() };
+  const theta_sketch_alloc<A>* sketches[2] = { &a, &b };
+  const matrix result = jaccard_matrix(sketches, &sketches[2]);
+  return result[1];
+}
+
+template<typename A>
+template<typename Iterator>
+typename theta_jaccard_similarity_alloc<A>::matrix theta_jaccard_similarity_alloc<A>::jaccard_matrix(Iterator first, Iterator last, unsigned num_threads) {
+  vector_u64 pool;
+  vector_sorted_keys sketches;
+  bool is_seed_hash_set = false;
+  uint16_t seed_hash = 0;
+  for (Iterator it = first; it != last; ++it) {
+    const theta_sketch_alloc<A>& sketch = as_theta_sketch<A>(*it);
+    if (!sketch.is_empty()) {
+      if (!is_seed_hash_set) {
+        seed_hash = sketch.get_seed_hash();
+        is_seed_hash_set = true;
+      } else if (sketch.get_seed_hash() != seed_hash) {
+        throw std::invalid_argument("seed hash mismatch");
+      }
+    }
+    add_sketch(sketch, pool, sketches);
+  }
+
+  const uint32_t n = sketches.size();
+  matrix result(static_cast<size_t>(n) * n);
+  // tiles of the upper triangle including the diagonal
+  typedef std::pair<uint32_t, uint32_t> tile;
+  typedef typename std::allocator_traits<A>::template rebind_alloc<tile> AllocTile;
+  std::vector<tile, AllocTile> tiles;
+  for (uint32_t i = 0; i < n; i += BLOCK_SIZE) {
+    for (uint32_t j = i; j < n; j += BLOCK_SIZE) tiles.push_back(tile(i, j));
+  }
+
+  std::atomic<size_t> next_tile(0);
+  auto process_tiles = [&]() {
+    for (size_t t = next_tile++; t < tiles.size(); t = next_tile++) {
+      const uint32_t row_end = std::min(tiles[t].first + BLOCK_SIZE, n);
+      const uint32_t col_end = std::min(tiles[t].second + BLOCK_SIZE, n);
+      for (uint32_t i = tiles[t].first; i < row_end; i++) {
+        for (uint32_t j = std::max(i, tiles[t].second); j < col_end; j++) {
+          similarity s = compute(pool.data(), sketches[i], sketches[j]);
+          if (i == j) s.lower_bound = s.estimate = s.upper_bound = 1; // identical sets
+          result[static_cast<size_t>(i) * n + j] = s;
+          result[static_cast<size_t>(j) * n + i] = s;
+        }
+      }
+    }
+  };
+
+  if (num_threads == 0) num_threads = std::max(1U, std::thread::hardware_concurrency());
+  num_threads = std::min(num_threads, static_cast<unsigned>(tiles.size()));
+  if (num_threads <= 1) {
+    process_tiles();
+  } else {
+    std::vector<std::thread> threads;
+    for (unsigned i = 0; i < num_threads; i++) threads.push_back(std::thread(process_tiles));
+    for (auto& thread: threads) thread.join();
+  }
+  return result;
+}
+
+template<typename A>
+void theta_jaccard_similarity_alloc<A>::add_sketch(const theta_sketch_alloc<A>& sketch, vector_u64& pool, vector_sorted_keys& sketches) {
+  const size_t offset = pool.size();
+  pool.insert(pool.end(), sketch.begin(), sketch.end());
+  if (!sketch.is_ordered()) std::sort(pool.begin() + offset, pool.end());
+  sketches.push_back(sorted_keys { offset, static_cast<uint32_t>(pool.size() - offset), sketch.get_theta64(), sketch.is_empty() });
+}
+
+template<typename A>
+typename theta_jaccard_similarity_alloc<A>::similarity theta_jaccard_similarity_alloc<A>::compute(const uint64_t* pool,
+    const sorted_keys& a, const sorted_keys& b) {
+  if (a.is_empty and b.is_empty) return similarity { 1, 1, 1, 0 };
+  if (a.is_empty or b.is_empty) return similarity { 0, 0, 0, 0 };
+  const uint64_t theta = std::min(a.theta, b.theta);
+  const uint64_t* keys_a = &pool[a.offset];
+  const uint64_t* keys_b = &pool[b.offset];
+  const uint32_t num_a = std::lower_bound(keys_a, &keys_a[a.num_keys], theta) - keys_a;
+  const uint32_t num_b = std::lower_bound(keys_b, &keys_b[b.num_keys], theta) - keys_b;
+  // the same merge or galloping search as the intersection, counting only
+  const uint32_t num_intersection = num_a < num_b
+      ? theta_intersection_alloc<A>::intersect_sorted(keys_a, num_a, keys_b, num_b, nullptr)
+      : theta_intersection_alloc<A>::intersect_sorted(keys_b, num_b, keys_a, num_a, nullptr);
+  const uint32_t num_union = num_a + num_b - num_intersection;
+  const double intersection_estimate = num_intersection / (static_cast<double>(theta) / theta_sketch_alloc<A>::MAX_THETA);
+  if (num_union == 0) return similarity { 0, 0.5, 1, 0 }; // no data below theta
+  return similarity {
+    bounds_binomial_proportions::approximate_lower_bound_on_p(num_union, num_intersection, NUM_STD_DEVS),
+    static_cast<double>(num_intersection) / num_union,
+    bounds_binomial_proportions::approximate_upper_bound_on_p(num_union, num_intersection, NUM_STD_DEVS),
+    intersection_estimate
+  };
+}
+
+} /* namespace datasketches */
+
+#endif
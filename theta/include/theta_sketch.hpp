@@ -37,9 +37,12 @@ namespace datasketches {
 template<typename A> class theta_sketch_alloc;
 template<typename A> class update_theta_sketch_alloc;
 template<typename A> class compact_theta_sketch_alloc;
+template<typename A> class wrapped_compact_theta_sketch_alloc;
 template<typename A> class theta_union_alloc;
 template<typename A> class theta_intersection_alloc;
 template<typename A> class theta_a_not_b_alloc;
+template<typename A> class theta_expression_alloc;
+template<typename A> class concurrent_theta_sketch_alloc;
 
 // for serialization as raw bytes
 template<typename A> using AllocU8 = typename std::allocator_traits<A>::template rebind_alloc<uint8_t>;
@@ -96,17 +99,50 @@ protected:
   static void check_seed_hash(uint16_t actual, uint16_t expected);
   static void check_size(size_t actual, size_t expected);
 
+  // raw key storage for set operations: the keys of a compact sketch,
+  // or all the slots of a hash table, with zeros in the empty ones
+  virtual const uint64_t* get_keys() const = 0;
+  virtual uint32_t get_num_key_slots() const = 0;
+
+  friend theta_union_alloc<A>;
   friend theta_intersection_alloc<A>;
   friend theta_a_not_b_alloc<A>;
+  friend theta_expression_alloc<A>;
+};
+
+// typed updates, reduced to bytes the same way by everything that hashes values into theta sketches
+// Derived must provide update(const void* data, unsigned length)
+
+template<typename Derived>
+class theta_update_interface {
+public:
+  void update(const std::string& value);
+  void update(uint64_t value);
+  void update(int64_t value);
+
+  // for compatibility with Java implementation
+  void update(uint32_t value);
+  void update(int32_t value);
+  void update(uint16_t value);
+  void update(int16_t value);
+  void update(uint8_t value);
+  void update(int8_t value);
+  void update(double value);
+  void update(float value);
 };
 
 // update sketch
 
 template<typename A>
-class update_theta_sketch_alloc: public theta_sketch_alloc<A> {
+class update_theta_sketch_alloc: public theta_sketch_alloc<A>, public theta_update_interface<update_theta_sketch_alloc<A>> {
 public:
   class builder;
   enum resize_factor { X1, X2, X4, X8 };
+  // STRIDED: open addressing with a stride derived from the hash, each probe touching a different cache line
+  // BUCKETIZED: the table is divided into buckets of 8 keys (64 bytes), filled from the start,
+  // and a full bucket overflows into the next one, so most probes stay within a bucket
+  // serialized update sketches always use the strided layout for compatibility
+  enum table_layout { STRIDED, BUCKETIZED };
   static const uint8_t SKETCH_TYPE = 2;
 
   update_theta_sketch_alloc(const update_theta_sketch_alloc<A>& other);
@@ -125,19 +161,7 @@ public:
   // header space is reserved, but not initialized
   virtual vector_bytes serialize(unsigned header_size_bytes = 0) const;
 
-  void update(const std::string& value);
-  void update(uint64_t value);
-  void update(int64_t value);
-
-  // for compatibility with Java implementation
-  void update(uint32_t value);
-  void update(int32_t value);
-  void update(uint16_t value);
-  void update(int16_t value);
-  void update(uint8_t value);
-  void update(int8_t value);
-  void update(double value);
-  void update(float value);
+  using theta_update_interface<update_theta_sketch_alloc<A>>::update;
 
   // Be very careful to hash input values consistently using the same approach
   // either over time or on different platforms
@@ -147,9 +171,30 @@ public:
   // which does widening conversion to int64_t, if compatibility with Java is expected
   void update(const void* data, unsigned length);
 
+  // Update with a hash computed by the caller as MurmurHash3_x64_128(data, length, seed),
+  // where h0 and h1 are the two 64-bit halves of the result (HashState::h1 and h2).
+  // Equivalent to update(data, length), so the same hash can feed theta, HLL and CPC sketches.
+  // Only h0 is used by theta sketches. Throws if the seed differs from the seed of this sketch.
+  void update_hashed(uint64_t h0, uint64_t h1, uint64_t seed = builder::DEFAULT_SEED);
+
+  // Batch updates, equivalent to calling the corresponding single-value update for each item.
+  // Items are hashed in blocks and the target slots are prefetched before insertion,
+  // which hides most of the cache misses on tables that do not fit in cache.
+  void update_batch(const uint64_t* values, size_t num);
+  void update_batch(const int64_t* values, size_t num);
+  // empty strings are ignored as in update(const std::string&)
+  void update_batch(const std::string* values, size_t num);
+  // item i is the sequence of bytes from data + offsets[i] to data + offsets[i + 1],
+  // so the offsets array must have num + 1 elements (Apache Arrow binary layout)
+  // empty items are ignored as in update(const std::string&)
+  void update_batch(const char* data, const uint32_t* offsets, size_t num);
+
   // remove retained entries in excess of the nominal size k (if any)
   void trim();
 
+  // returns to the initial empty state, keeping the allocated hash table
+  void reset();
+
   compact_theta_sketch_alloc<A> compact(bool ordered = true) const;
 
   virtual typename theta_sketch_alloc<A>::const_iterator begin() const;
@@ -158,7 +203,16 @@ public:
   static update_theta_sketch_alloc<A> deserialize(std::istream& is, uint64_t seed = builder::DEFAULT_SEED);
   static update_theta_sketch_alloc<A> deserialize(const void* bytes, size_t size, uint64_t seed = update_theta_sketch_alloc<A>::builder::DEFAULT_SEED);
 
+  // Takes ownership of a buffer holding a serialized image (as produced by serialize() with no header),
+  // allocated by the allocator of this sketch rebound to uint64_t for exactly size_longs words.
+  // The hash table is used in place, so the keys are not copied.
+  // If an exception is thrown, the buffer remains owned by the caller.
+  static update_theta_sketch_alloc<A> adopt(uint64_t* buffer, size_t size_longs, uint64_t seed = update_theta_sketch_alloc<A>::builder::DEFAULT_SEED);
+
 private:
+  virtual const uint64_t* get_keys() const;
+  virtual uint32_t get_num_key_slots() const;
+
   // resize threshold = 0.5 tuned for speed
   static constexpr double RESIZE_THRESHOLD = 0.5;
   // hash table rebuild threshold = 15/16
@@ -167,34 +221,57 @@ private:
   static constexpr uint8_t STRIDE_HASH_BITS = 7;
   static constexpr uint32_t STRIDE_MASK = (1 << STRIDE_HASH_BITS) - 1;
 
+  // number of items hashed and prefetched ahead of insertion in batch updates
+  static const unsigned BATCH_SIZE = 16;
+
+  // hashes use 63 bits, so the top bit is free to mark keys already placed during in-place rebuild
+  static const uint64_t REBUILD_MARK = 1ULL << 63;
+
+  // number of keys in a bucket of the bucketized layout
+  static const uint32_t BUCKET_SIZE = 8;
+
   uint8_t lg_cur_size_;
   uint8_t lg_nom_size_;
   uint64_t* keys_;
+  // number of words before keys_ in its allocation, non-zero if adopted from a serialized image
+  uint8_t keys_offset_;
   uint32_t num_keys_;
   resize_factor rf_;
   float p_;
   uint64_t seed_;
   uint32_t capacity_;
+  table_layout layout_;
 
   typedef typename std::allocator_traits<A>::template rebind_alloc<uint64_t> AllocU64;
 
   // for builder
-  update_theta_sketch_alloc(uint8_t lg_cur_size, uint8_t lg_nom_size, resize_factor rf, float p, uint64_t seed);
+  update_theta_sketch_alloc(uint8_t lg_cur_size, uint8_t lg_nom_size, resize_factor rf, float p, uint64_t seed, table_layout layout);
   // for deserialize
   update_theta_sketch_alloc(bool is_empty, uint64_t theta, uint8_t lg_cur_size, uint8_t lg_nom_size, uint64_t* keys, uint32_t num_keys, resize_factor rf, float p, uint64_t seed);
 
   void resize();
   void rebuild();
+  void deallocate_keys();
+  void rehash_strided_in_place();
+  void rehash_bucketized_in_place();
+  // fills a table of the current size with the keys in the strided layout
+  void copy_strided(uint64_t* table) const;
 
   friend theta_union_alloc<A>;
+  friend concurrent_theta_sketch_alloc<A>;
   void internal_update(uint64_t hash);
+  void internal_update(const uint64_t* hashes, unsigned num);
+  uint64_t compute_hash(const void* data, unsigned length) const;
 
   friend theta_intersection_alloc<A>;
   friend theta_a_not_b_alloc<A>;
   static inline uint32_t get_capacity(uint8_t lg_cur_size, uint8_t lg_nom_size);
   static inline uint32_t get_stride(uint64_t hash, uint8_t lg_size);
   static bool hash_search_or_insert(uint64_t hash, uint64_t* table, uint8_t lg_size);
+  // the hash must not be present in the table
+  static void hash_insert(uint64_t hash, uint64_t* table, uint8_t lg_size);
   static bool hash_search(uint64_t hash, const uint64_t* table, uint8_t lg_size);
+  static bool bucket_search_or_insert(uint64_t hash, uint64_t* table, uint8_t lg_size);
 
   friend theta_sketch_alloc<A>;
   static update_theta_sketch_alloc<A> internal_deserialize(std::istream& is, resize_factor rf, uint8_t lg_cur_size, uint8_t lg_nom_size, uint8_t flags_byte, uint64_t seed);
@@ -207,6 +284,7 @@ template<typename A>
 class compact_theta_sketch_alloc: public theta_sketch_alloc<A> {
 public:
   static const uint8_t SKETCH_TYPE = 3;
+  static const uint8_t COMPRESSED_SERIAL_VERSION = 4;
 
   compact_theta_sketch_alloc(const compact_theta_sketch_alloc<A>& other);
   compact_theta_sketch_alloc(const theta_sketch_alloc<A>& other, bool ordered);
@@ -225,14 +303,41 @@ public:
   // header space is reserved, but not initialized
   virtual vector_bytes serialize(unsigned header_size_bytes = 0) const;
 
+  // Compressed format (serial version 4) recognized by deserialize():
+  // keys of ordered sketches are delta-encoded and bit-packed.
+  // Unordered, empty and single-item sketches are serialized in the regular format.
+  // All deltas use one bit width, that of the largest, as in the serial version 4 layout of
+  // other implementations. Keys are uniform hashes, so each delta needs about 64 - log2(num keys) bits
+  // whatever the encoding: the result is 0.73 to 0.88 of the regular size, and widths per block
+  // of 8 would gain at most 2% of it.
+  void serialize_compressed(std::ostream& os) const;
+  // header space is reserved, but not initialized
+  vector_bytes serialize_compressed(unsigned header_size_bytes = 0) const;
+
   virtual typename theta_sketch_alloc<A>::const_iterator begin() const;
   virtual typename theta_sketch_alloc<A>::const_iterator end() const;
 
   static compact_theta_sketch_alloc<A> deserialize(std::istream& is, uint64_t seed = update_theta_sketch_alloc<A>::builder::DEFAULT_SEED);
   static compact_theta_sketch_alloc<A> deserialize(const void* bytes, size_t size, uint64_t seed = update_theta_sketch_alloc<A>::builder::DEFAULT_SEED);
 
+  // Builds an ordered sketch from hashes computed by the caller as in update_theta_sketch_alloc,
+  // that is HashState::h1 >> 1 of MurmurHash3_x64_128(data, length, seed), in any order and with duplicates.
+  // The smallest 2^lg_k distinct hashes below sampling probability p are retained. The result serializes
+  // byte for byte the same as the update sketch built with the same lg_k, p and seed, trimmed and compacted.
+  // Sorted input takes a single pass, otherwise the hashes are copied and selected in linear expected time.
+  static compact_theta_sketch_alloc<A> from_hashes(const uint64_t* hashes, size_t num,
+      uint8_t lg_k = update_theta_sketch_alloc<A>::builder::DEFAULT_LG_K, float p = 1,
+      uint64_t seed = update_theta_sketch_alloc<A>::builder::DEFAULT_SEED);
+
 private:
   typedef typename std::allocator_traits<A>::template rebind_alloc<uint64_t> AllocU64;
+  typedef std::vector<uint64_t, AllocU64> vector_u64;
+
+  virtual const uint64_t* get_keys() const;
+  virtual uint32_t get_num_key_slots() const;
+
+  // sorts and keeps the smallest num + 1 distinct keys
+  static void select_smallest_distinct(vector_u64& keys, uint32_t num);
 
   uint64_t* keys_;
   uint32_t num_keys_;
@@ -244,9 +349,68 @@ private:
   friend theta_union_alloc<A>;
   friend theta_intersection_alloc<A>;
   friend theta_a_not_b_alloc<A>;
+  friend theta_expression_alloc<A>;
   compact_theta_sketch_alloc(bool is_empty, uint64_t theta, uint64_t* keys, uint32_t num_keys, uint16_t seed_hash, bool is_ordered);
+  static uint8_t get_preamble_longs(bool is_empty, uint64_t theta, uint32_t num_keys);
+  // returns the position of the keys
+  static uint8_t* write_preamble(uint8_t* ptr, uint8_t preamble_longs, bool is_empty, uint64_t theta, uint32_t num_keys, uint16_t seed_hash, bool is_ordered);
+  // serializes a result computed in the given buffer with the keys starting at MAX_PREAMBLE_BYTES
+  static size_t serialize_in_place(uint8_t* ptr, bool is_empty, uint64_t theta, uint32_t num_keys, uint16_t seed_hash, bool is_ordered);
+  static const size_t MAX_PREAMBLE_BYTES = 24;
+
   static compact_theta_sketch_alloc<A> internal_deserialize(std::istream& is, uint8_t preamble_longs, uint8_t flags_byte, uint16_t seed_hash);
   static compact_theta_sketch_alloc<A> internal_deserialize(const void* bytes, size_t size, uint8_t preamble_longs, uint8_t flags_byte, uint16_t seed_hash);
+
+  bool is_suitable_for_compression() const;
+  uint8_t compute_entry_bits() const;
+  static uint8_t get_num_entries_bytes(uint32_t num_entries);
+  size_t get_compressed_serialized_size_bytes(uint8_t entry_bits, uint8_t num_entries_bytes) const;
+  void pack_keys(uint8_t entry_bits, uint8_t* ptr) const;
+  static void unpack_keys(uint64_t* keys, uint32_t num_keys, uint8_t entry_bits, const uint8_t* ptr);
+  static compact_theta_sketch_alloc<A> internal_deserialize_compressed(std::istream& is, uint8_t preamble_longs, uint8_t entry_bits,
+      uint8_t num_entries_bytes, uint8_t flags_byte, uint16_t seed_hash);
+  static compact_theta_sketch_alloc<A> internal_deserialize_compressed(const void* bytes, size_t size, uint8_t preamble_longs, uint8_t entry_bits,
+      uint8_t num_entries_bytes, uint8_t flags_byte, uint16_t seed_hash);
+};
+
+// read-only view of a serialized compact sketch
+
+/*
+ * Wraps the serialized image of a compact sketch without copying the keys,
+ * so it can be queried or passed to set operations directly from memory-mapped data.
+ * The view does not own the bytes, which must outlive it and must not change.
+ * The retained keys must be 8-byte aligned in memory, which holds if the buffer is.
+ */
+template<typename A>
+class wrapped_compact_theta_sketch_alloc: public theta_sketch_alloc<A> {
+public:
+  virtual uint32_t get_num_retained() const;
+  virtual uint16_t get_seed_hash() const;
+  virtual bool is_ordered() const;
+  virtual void to_stream(std::ostream& os, bool print_items = false) const;
+  virtual void serialize(std::ostream& os) const;
+  typedef vector_u8<A> vector_bytes; // alias for users
+  // header space is reserved, but not initialized
+  virtual vector_bytes serialize(unsigned header_size_bytes = 0) const;
+
+  virtual typename theta_sketch_alloc<A>::const_iterator begin() const;
+  virtual typename theta_sketch_alloc<A>::const_iterator end() const;
+
+  // the size may exceed the size of the sketch image, the rest of the buffer is ignored
+  static wrapped_compact_theta_sketch_alloc<A> wrap(const void* bytes, size_t size, uint64_t seed = update_theta_sketch_alloc<A>::builder::DEFAULT_SEED);
+
+private:
+  const void* bytes_;
+  size_t size_bytes_;
+  const uint64_t* keys_;
+  uint32_t num_keys_;
+  uint16_t seed_hash_;
+  bool is_ordered_;
+
+  virtual const uint64_t* get_keys() const;
+  virtual uint32_t get_num_key_slots() const;
+
+  wrapped_compact_theta_sketch_alloc(bool is_empty, uint64_t theta, const void* bytes, size_t size_bytes, const uint64_t* keys, uint32_t num_keys, uint16_t seed_hash, bool is_ordered);
 };
 
 // builder
@@ -255,21 +419,25 @@ template<typename A>
 class update_theta_sketch_alloc<A>::builder {
 public:
   static const uint8_t MIN_LG_K = 5;
+  static const uint8_t MAX_LG_K = 26;
   static const uint8_t DEFAULT_LG_K = 12;
   static const resize_factor DEFAULT_RESIZE_FACTOR = X8;
   static const uint64_t DEFAULT_SEED = 9001;
+  static const table_layout DEFAULT_TABLE_LAYOUT = STRIDED;
 
   builder();
   builder& set_lg_k(uint8_t lg_k);
   builder& set_resize_factor(resize_factor rf);
   builder& set_p(float p);
   builder& set_seed(uint64_t seed);
+  builder& set_table_layout(table_layout layout);
   update_theta_sketch_alloc<A> build() const;
 private:
   uint8_t lg_k_;
   resize_factor rf_;
   float p_;
   uint64_t seed_;
+  table_layout layout_;
 
   static uint8_t starting_sub_multiple(uint8_t lg_tgt, uint8_t lg_min, uint8_t lg_rf);
 };
@@ -291,6 +459,7 @@ private:
   const_iterator(const uint64_t* keys, uint32_t size, uint32_t index);
   friend class update_theta_sketch_alloc<A>;
   friend class compact_theta_sketch_alloc<A>;
+  friend class wrapped_compact_theta_sketch_alloc<A>;
 };
 
 
@@ -298,6 +467,7 @@ private:
 typedef theta_sketch_alloc<std::allocator<void>> theta_sketch;
 typedef update_theta_sketch_alloc<std::allocator<void>> update_theta_sketch;
 typedef compact_theta_sketch_alloc<std::allocator<void>> compact_theta_sketch;
+typedef wrapped_compact_theta_sketch_alloc<std::allocator<void>> wrapped_compact_theta_sketch;
 
 // common helping functions
 
@@ -309,6 +479,17 @@ constexpr uint8_t lg_size_from_count(uint32_t n, double load_factor) {
   return log2(n) + ((n > static_cast<uint32_t>((1 << (log2(n) + 1)) * load_factor)) ? 2 : 1);
 }
 
+// for set operations over ranges of sketches or pointers to sketches
+template<typename A>
+const theta_sketch_alloc<A>& as_theta_sketch(const theta_sketch_alloc<A>& sketch) {
+  return sketch;
+}
+
+template<typename A>
+const theta_sketch_alloc<A>& as_theta_sketch(const theta_sketch_alloc<A>* sketch) {
+  return *sketch;
+}
+
 } /* namespace datasketches */
 
 #include "theta_sketch_impl.hpp"
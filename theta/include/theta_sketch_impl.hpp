@@ -22,6 +22,7 @@
 
 #include <algorithm>
 #include <cmath>
+#include <cstring>
 #include <memory>
 #include <functional>
 #include <istream>
@@ -29,7 +30,9 @@
 
 #include "MurmurHash3.h"
 #include "serde.hpp"
+#include "CommonUtil.hpp"
 #include "binomial_bounds.hpp"
+#include "bit_packing.hpp"
 
 namespace datasketches {
 
@@ -126,7 +129,10 @@ typename theta_sketch_alloc<A>::unique_ptr theta_sketch_alloc<A>::deserialize(st
   uint16_t seed_hash;
   is.read((char*)&seed_hash, sizeof(seed_hash));
 
-  check_serial_version(serial_version, SERIAL_VERSION);
+  // in compressed compact sketches the bytes read as lg_nom_size and lg_cur_size
+  // hold the number of bits per entry and the number of bytes of the entry count
+  const bool is_compressed = type == compact_theta_sketch_alloc<A>::SKETCH_TYPE and serial_version == compact_theta_sketch_alloc<A>::COMPRESSED_SERIAL_VERSION;
+  if (!is_compressed) check_serial_version(serial_version, SERIAL_VERSION);
   check_seed_hash(seed_hash, get_seed_hash(seed));
 
   if (type == update_theta_sketch_alloc<A>::SKETCH_TYPE) {
@@ -142,7 +148,10 @@ typename theta_sketch_alloc<A>::unique_ptr theta_sketch_alloc<A>::deserialize(st
   } else if (type == compact_theta_sketch_alloc<A>::SKETCH_TYPE) {
     typedef typename std::allocator_traits<A>::template rebind_alloc<compact_theta_sketch_alloc<A>> AC;
     return unique_ptr(
-      static_cast<theta_sketch_alloc<A>*>(new (AC().allocate(1)) compact_theta_sketch_alloc<A>(compact_theta_sketch_alloc<A>::internal_deserialize(is, preamble_longs, flags_byte, seed_hash))),
+      static_cast<theta_sketch_alloc<A>*>(new (AC().allocate(1)) compact_theta_sketch_alloc<A>(is_compressed ?
+        compact_theta_sketch_alloc<A>::internal_deserialize_compressed(is, preamble_longs, lg_nom_size, lg_cur_size, flags_byte, seed_hash) :
+        compact_theta_sketch_alloc<A>::internal_deserialize(is, preamble_longs, flags_byte, seed_hash))
+      ),
       [](theta_sketch_alloc<A>* ptr) {
         ptr->~theta_sketch_alloc();
         AC().deallocate(static_cast<compact_theta_sketch_alloc<A>*>(ptr), 1);
@@ -171,7 +180,10 @@ typename theta_sketch_alloc<A>::unique_ptr theta_sketch_alloc<A>::deserialize(co
   uint16_t seed_hash;
   ptr += copy_from_mem(ptr, &seed_hash, sizeof(seed_hash));
 
-  check_serial_version(serial_version, SERIAL_VERSION);
+  // in compressed compact sketches the bytes read as lg_nom_size and lg_cur_size
+  // hold the number of bits per entry and the number of bytes of the entry count
+  const bool is_compressed = type == compact_theta_sketch_alloc<A>::SKETCH_TYPE and serial_version == compact_theta_sketch_alloc<A>::COMPRESSED_SERIAL_VERSION;
+  if (!is_compressed) check_serial_version(serial_version, SERIAL_VERSION);
   check_seed_hash(seed_hash, get_seed_hash(seed));
 
   if (type == update_theta_sketch_alloc<A>::SKETCH_TYPE) {
@@ -189,7 +201,8 @@ typename theta_sketch_alloc<A>::unique_ptr theta_sketch_alloc<A>::deserialize(co
   } else if (type == compact_theta_sketch_alloc<A>::SKETCH_TYPE) {
     typedef typename std::allocator_traits<A>::template rebind_alloc<compact_theta_sketch_alloc<A>> AC;
     return unique_ptr(
-      static_cast<theta_sketch_alloc<A>*>(new (AC().allocate(1)) compact_theta_sketch_alloc<A>(
+      static_cast<theta_sketch_alloc<A>*>(new (AC().allocate(1)) compact_theta_sketch_alloc<A>(is_compressed ?
+        compact_theta_sketch_alloc<A>::internal_deserialize_compressed(ptr, size - (ptr - static_cast<const char*>(bytes)), preamble_longs, lg_nom_size, lg_cur_size, flags_byte, seed_hash) :
         compact_theta_sketch_alloc<A>::internal_deserialize(ptr, size - (ptr - static_cast<const char*>(bytes)), preamble_longs, flags_byte, seed_hash))
       ),
       [](theta_sketch_alloc<A>* ptr) {
@@ -236,19 +249,91 @@ void theta_sketch_alloc<A>::check_size(size_t actual, size_t expected) {
   }
 }
 
+// typed updates
+
+template<typename Derived>
+void theta_update_interface<Derived>::update(const std::string& value) {
+  if (value.empty()) return;
+  static_cast<Derived*>(this)->update(value.c_str(), value.length());
+}
+
+template<typename Derived>
+void theta_update_interface<Derived>::update(uint64_t value) {
+  static_cast<Derived*>(this)->update(&value, sizeof(value));
+}
+
+template<typename Derived>
+void theta_update_interface<Derived>::update(int64_t value) {
+  static_cast<Derived*>(this)->update(&value, sizeof(value));
+}
+
+template<typename Derived>
+void theta_update_interface<Derived>::update(uint32_t value) {
+  update(static_cast<int32_t>(value));
+}
+
+template<typename Derived>
+void theta_update_interface<Derived>::update(int32_t value) {
+  update(static_cast<int64_t>(value));
+}
+
+template<typename Derived>
+void theta_update_interface<Derived>::update(uint16_t value) {
+  update(static_cast<int16_t>(value));
+}
+
+template<typename Derived>
+void theta_update_interface<Derived>::update(int16_t value) {
+  update(static_cast<int64_t>(value));
+}
+
+template<typename Derived>
+void theta_update_interface<Derived>::update(uint8_t value) {
+  update(static_cast<int8_t>(value));
+}
+
+template<typename Derived>
+void theta_update_interface<Derived>::update(int8_t value) {
+  update(static_cast<int64_t>(value));
+}
+
+template<typename Derived>
+void theta_update_interface<Derived>::update(double value) {
+  union {
+    int64_t long_value;
+    double double_value;
+  } long_double_union;
+
+  if (value == 0.0) {
+    long_double_union.double_value = 0.0; // canonicalize -0.0 to 0.0
+  } else if (std::isnan(value)) {
+    long_double_union.long_value = 0x7ff8000000000000L; // canonicalize NaN using value from Java's Double.doubleToLongBits()
+  } else {
+    long_double_union.double_value = value;
+  }
+  static_cast<Derived*>(this)->update(&long_double_union, sizeof(long_double_union));
+}
+
+template<typename Derived>
+void theta_update_interface<Derived>::update(float value) {
+  update(static_cast<double>(value));
+}
+
 // update sketch
 
 template<typename A>
-update_theta_sketch_alloc<A>::update_theta_sketch_alloc(uint8_t lg_cur_size, uint8_t lg_nom_size, resize_factor rf, float p, uint64_t seed):
+update_theta_sketch_alloc<A>::update_theta_sketch_alloc(uint8_t lg_cur_size, uint8_t lg_nom_size, resize_factor rf, float p, uint64_t seed, table_layout layout):
 theta_sketch_alloc<A>(true, theta_sketch_alloc<A>::MAX_THETA),
 lg_cur_size_(lg_cur_size),
 lg_nom_size_(lg_nom_size),
 keys_(AllocU64().allocate(1 << lg_cur_size_)),
+keys_offset_(0),
 num_keys_(0),
 rf_(rf),
 p_(p),
 seed_(seed),
-capacity_(get_capacity(lg_cur_size, lg_nom_size))
+capacity_(get_capacity(lg_cur_size, lg_nom_size)),
+layout_(layout)
 {
   if (p < 1) this->theta_ *= p;
   std::fill(keys_, &keys_[1 << lg_cur_size_], 0);
@@ -260,11 +345,13 @@ theta_sketch_alloc<A>(is_empty, theta),
 lg_cur_size_(lg_cur_size),
 lg_nom_size_(lg_nom_size),
 keys_(keys),
+keys_offset_(0),
 num_keys_(num_keys),
 rf_(rf),
 p_(p),
 seed_(seed),
-capacity_(get_capacity(lg_cur_size, lg_nom_size))
+capacity_(get_capacity(lg_cur_size, lg_nom_size)),
+layout_(STRIDED)
 {}
 
 template<typename A>
@@ -273,11 +360,13 @@ theta_sketch_alloc<A>(other),
 lg_cur_size_(other.lg_cur_size_),
 lg_nom_size_(other.lg_nom_size_),
 keys_(AllocU64().allocate(1 << lg_cur_size_)),
+keys_offset_(0),
 num_keys_(other.num_keys_),
 rf_(other.rf_),
 p_(other.p_),
 seed_(other.seed_),
-capacity_(other.capacity_)
+capacity_(other.capacity_),
+layout_(other.layout_)
 {
   std::copy(other.keys_, &other.keys_[1 << lg_cur_size_], keys_);
 }
@@ -288,27 +377,31 @@ theta_sketch_alloc<A>(std::move(other)),
 lg_cur_size_(other.lg_cur_size_),
 lg_nom_size_(other.lg_nom_size_),
 keys_(nullptr),
+keys_offset_(0),
 num_keys_(other.num_keys_),
 rf_(other.rf_),
 p_(other.p_),
 seed_(other.seed_),
-capacity_(other.capacity_)
+capacity_(other.capacity_),
+layout_(other.layout_)
 {
   std::swap(keys_, other.keys_);
+  std::swap(keys_offset_, other.keys_offset_);
 }
 
 template<typename A>
 update_theta_sketch_alloc<A>::~update_theta_sketch_alloc() {
-  AllocU64().deallocate(keys_, 1 << lg_cur_size_);
+  deallocate_keys();
 }
 
 template<typename A>
 update_theta_sketch_alloc<A>& update_theta_sketch_alloc<A>::operator=(const update_theta_sketch_alloc<A>& other) {
   theta_sketch_alloc<A>::operator=(other);
   if (lg_cur_size_ != other.lg_cur_size_) {
-    AllocU64().deallocate(keys_, 1 << lg_cur_size_);
+    deallocate_keys();
     lg_cur_size_ = other.lg_cur_size_;
     keys_ = AllocU64().allocate(1 << lg_cur_size_);
+    keys_offset_ = 0;
   }
   lg_nom_size_ = other.lg_nom_size_;
   std::copy(other.keys_, &other.keys_[1 << lg_cur_size_], keys_);
@@ -317,6 +410,7 @@ update_theta_sketch_alloc<A>& update_theta_sketch_alloc<A>::operator=(const upda
   p_ = other.p_;
   seed_ = other.seed_;
   capacity_ = other.capacity_;
+  layout_ = other.layout_;
   return *this;
 }
 
@@ -326,11 +420,13 @@ update_theta_sketch_alloc<A>& update_theta_sketch_alloc<A>::operator=(update_the
   std::swap(lg_cur_size_, other.lg_cur_size_);
   lg_nom_size_ = other.lg_nom_size_;
   std::swap(keys_, other.keys_);
+  std::swap(keys_offset_, other.keys_offset_);
   num_keys_ = other.num_keys_;
   rf_ = other.rf_;
   p_ = other.p_;
   seed_ = other.seed_;
   capacity_ = other.capacity_;
+  layout_ = other.layout_;
   return *this;
 }
 
@@ -392,7 +488,13 @@ void update_theta_sketch_alloc<A>::serialize(std::ostream& os) const {
   os.write((char*)&num_keys_, sizeof(num_keys_));
   os.write((char*)&p_, sizeof(p_));
   os.write((char*)&(this->theta_), sizeof(uint64_t));
-  os.write((char*)keys_, sizeof(uint64_t) * (1 << lg_cur_size_));
+  if (layout_ == STRIDED) {
+    os.write((char*)keys_, sizeof(uint64_t) * (1 << lg_cur_size_));
+  } else {
+    std::vector<uint64_t, AllocU64> table(1 << lg_cur_size_);
+    copy_strided(table.data());
+    os.write((char*)table.data(), sizeof(uint64_t) * table.size());
+  }
 }
 
 template<typename A>
@@ -419,7 +521,13 @@ vector_u8<A> update_theta_sketch_alloc<A>::serialize(unsigned header_size_bytes)
   ptr += copy_to_mem(&num_keys_, ptr, sizeof(num_keys_));
   ptr += copy_to_mem(&p_, ptr, sizeof(p_));
   ptr += copy_to_mem(&(this->theta_), ptr, sizeof(uint64_t));
-  ptr += copy_to_mem(keys_, ptr, sizeof(uint64_t) * (1 << lg_cur_size_));
+  if (layout_ == STRIDED) {
+    ptr += copy_to_mem(keys_, ptr, sizeof(uint64_t) * (1 << lg_cur_size_));
+  } else {
+    std::vector<uint64_t, AllocU64> table(1 << lg_cur_size_);
+    copy_strided(table.data());
+    ptr += copy_to_mem(table.data(), ptr, sizeof(uint64_t) * table.size());
+  }
 
   return bytes;
 }
@@ -506,79 +614,116 @@ update_theta_sketch_alloc<A> update_theta_sketch_alloc<A>::internal_deserialize(
 }
 
 template<typename A>
-void update_theta_sketch_alloc<A>::update(const std::string& value) {
-  if (value.empty()) return;
-  update(value.c_str(), value.length());
-}
-
-template<typename A>
-void update_theta_sketch_alloc<A>::update(uint64_t value) {
-  update(&value, sizeof(value));
-}
-
-template<typename A>
-void update_theta_sketch_alloc<A>::update(int64_t value) {
-  update(&value, sizeof(value));
-}
-
-template<typename A>
-void update_theta_sketch_alloc<A>::update(uint32_t value) {
-  update(static_cast<int32_t>(value));
-}
-
-template<typename A>
-void update_theta_sketch_alloc<A>::update(int32_t value) {
-  update(static_cast<int64_t>(value));
+update_theta_sketch_alloc<A> update_theta_sketch_alloc<A>::adopt(uint64_t* buffer, size_t size_longs, uint64_t seed) {
+  const uint8_t preamble_longs = 3;
+  theta_sketch_alloc<A>::check_size(size_longs * sizeof(uint64_t), preamble_longs * sizeof(uint64_t));
+  const char* ptr = reinterpret_cast<const char*>(buffer);
+  uint8_t preamble_longs_and_rf;
+  ptr += copy_from_mem(ptr, &preamble_longs_and_rf, sizeof(preamble_longs_and_rf));
+  const resize_factor rf = static_cast<resize_factor>(preamble_longs_and_rf >> 6);
+  uint8_t serial_version;
+  ptr += copy_from_mem(ptr, &serial_version, sizeof(serial_version));
+  uint8_t type;
+  ptr += copy_from_mem(ptr, &type, sizeof(type));
+  uint8_t lg_nom_size;
+  ptr += copy_from_mem(ptr, &lg_nom_size, sizeof(lg_nom_size));
+  uint8_t lg_cur_size;
+  ptr += copy_from_mem(ptr, &lg_cur_size, sizeof(lg_cur_size));
+  uint8_t flags_byte;
+  ptr += copy_from_mem(ptr, &flags_byte, sizeof(flags_byte));
+  uint16_t seed_hash;
+  ptr += copy_from_mem(ptr, &seed_hash, sizeof(seed_hash));
+  uint32_t num_keys;
+  ptr += copy_from_mem(ptr, &num_keys, sizeof(num_keys));
+  float p;
+  ptr += copy_from_mem(ptr, &p, sizeof(p));
+  uint64_t theta;
+  ptr += copy_from_mem(ptr, &theta, sizeof(theta));
+  theta_sketch_alloc<A>::check_sketch_type(type, SKETCH_TYPE);
+  theta_sketch_alloc<A>::check_serial_version(serial_version, theta_sketch_alloc<A>::SERIAL_VERSION);
+  theta_sketch_alloc<A>::check_seed_hash(seed_hash, theta_sketch_alloc<A>::get_seed_hash(seed));
+  if ((preamble_longs_and_rf & 0x3f) != preamble_longs) throw std::invalid_argument("unexpected preamble size");
+  // the sizes come from the buffer, so they are checked before they are used to compute anything
+  if (lg_nom_size < builder::MIN_LG_K or lg_nom_size > builder::MAX_LG_K) {
+    throw std::invalid_argument("lg_nom_size out of range: " + std::to_string(lg_nom_size));
+  }
+  if (lg_cur_size < builder::MIN_LG_K or lg_cur_size > lg_nom_size + 1) {
+    throw std::invalid_argument("lg_cur_size out of range: " + std::to_string(lg_cur_size));
+  }
+  // the exact allocation size is needed to deallocate the buffer later
+  if (size_longs != preamble_longs + (static_cast<size_t>(1) << lg_cur_size)) {
+    throw std::invalid_argument("buffer size does not match the serialized table size");
+  }
+  const bool is_empty = flags_byte & (1 << theta_sketch_alloc<A>::flags::IS_EMPTY);
+  update_theta_sketch_alloc<A> sketch(is_empty, theta, lg_cur_size, lg_nom_size, buffer + preamble_longs, num_keys, rf, p, seed);
+  sketch.keys_offset_ = preamble_longs;
+  return sketch;
 }
 
 template<typename A>
-void update_theta_sketch_alloc<A>::update(uint16_t value) {
-  update(static_cast<int16_t>(value));
+void update_theta_sketch_alloc<A>::update(const void* data, unsigned length) {
+  internal_update(compute_hash(data, length));
 }
 
 template<typename A>
-void update_theta_sketch_alloc<A>::update(int16_t value) {
-  update(static_cast<int64_t>(value));
+void update_theta_sketch_alloc<A>::update_hashed(uint64_t h0, uint64_t, uint64_t seed) {
+  if (seed != seed_) throw std::invalid_argument("seed mismatch: expected " + std::to_string(seed_) + ", actual " + std::to_string(seed));
+  internal_update(h0 >> 1); // Java implementation does logical shift >>> to make values positive
 }
 
 template<typename A>
-void update_theta_sketch_alloc<A>::update(uint8_t value) {
-  update(static_cast<int8_t>(value));
+void update_theta_sketch_alloc<A>::update_batch(const uint64_t* values, size_t num) {
+  uint64_t hashes[BATCH_SIZE];
+  while (num > 0) {
+    const unsigned batch_size = std::min(num, static_cast<size_t>(BATCH_SIZE));
+    for (unsigned i = 0; i < batch_size; i++) hashes[i] = compute_hash(&values[i], sizeof(uint64_t));
+    internal_update(hashes, batch_size);
+    values += batch_size;
+    num -= batch_size;
+  }
 }
 
 template<typename A>
-void update_theta_sketch_alloc<A>::update(int8_t value) {
-  update(static_cast<int64_t>(value));
+void update_theta_sketch_alloc<A>::update_batch(const int64_t* values, size_t num) {
+  update_batch(reinterpret_cast<const uint64_t*>(values), num);
 }
 
 template<typename A>
-void update_theta_sketch_alloc<A>::update(double value) {
-  union {
-    int64_t long_value;
-    double double_value;
-  } long_double_union;
-
-  if (value == 0.0) {
-    long_double_union.double_value = 0.0; // canonicalize -0.0 to 0.0
-  } else if (std::isnan(value)) {
-    long_double_union.long_value = 0x7ff8000000000000L; // canonicalize NaN using value from Java's Double.doubleToLongBits()
-  } else {
-    long_double_union.double_value = value;
+void update_theta_sketch_alloc<A>::update_batch(const std::string* values, size_t num) {
+  uint64_t hashes[BATCH_SIZE];
+  while (num > 0) {
+    const unsigned batch_size = std::min(num, static_cast<size_t>(BATCH_SIZE));
+    unsigned num_hashes = 0;
+    for (unsigned i = 0; i < batch_size; i++) {
+      if (!values[i].empty()) hashes[num_hashes++] = compute_hash(values[i].c_str(), values[i].length());
+    }
+    internal_update(hashes, num_hashes);
+    values += batch_size;
+    num -= batch_size;
   }
-  update(&long_double_union, sizeof(long_double_union));
 }
 
 template<typename A>
-void update_theta_sketch_alloc<A>::update(float value) {
-  update(static_cast<double>(value));
+void update_theta_sketch_alloc<A>::update_batch(const char* data, const uint32_t* offsets, size_t num) {
+  uint64_t hashes[BATCH_SIZE];
+  while (num > 0) {
+    const unsigned batch_size = std::min(num, static_cast<size_t>(BATCH_SIZE));
+    unsigned num_hashes = 0;
+    for (unsigned i = 0; i < batch_size; i++) {
+      const uint32_t length = offsets[i + 1] - offsets[i];
+      if (length > 0) hashes[num_hashes++] = compute_hash(data + offsets[i], length);
+    }
+    internal_update(hashes, num_hashes);
+    offsets += batch_size;
+    num -= batch_size;
+  }
 }
 
 template<typename A>
-void update_theta_sketch_alloc<A>::update(const void* data, unsigned length) {
+uint64_t update_theta_sketch_alloc<A>::compute_hash(const void* data, unsigned length) const {
   HashState hashes;
   MurmurHash3_x64_128(data, length, seed_, hashes);
-  const uint64_t hash = hashes.h1 >> 1; // Java implementation does logical shift >>> to make values positive
-  internal_update(hash);
+  return hashes.h1 >> 1; // Java implementation does logical shift >>> to make values positive
 }
 
 template<typename A>
@@ -590,7 +735,8 @@ template<typename A>
 void update_theta_sketch_alloc<A>::internal_update(uint64_t hash) {
   this->is_empty_ = false;
   if (hash >= this->theta_ or hash == 0) return; // hash == 0 is reserved to mark empty slots in the table
-  if (hash_search_or_insert(hash, keys_, lg_cur_size_)) {
+  const bool inserted = layout_ == STRIDED ? hash_search_or_insert(hash, keys_, lg_cur_size_) : bucket_search_or_insert(hash, keys_, lg_cur_size_);
+  if (inserted) {
     num_keys_++;
     if (num_keys_ > capacity_) {
       if (lg_cur_size_ <= lg_nom_size_) {
@@ -602,11 +748,30 @@ void update_theta_sketch_alloc<A>::internal_update(uint64_t hash) {
   }
 }
 
+template<typename A>
+void update_theta_sketch_alloc<A>::internal_update(const uint64_t* hashes, unsigned num) {
+  // the table may grow while this batch is inserted, in which case some prefetches are wasted
+  const uint32_t mask = (1 << lg_cur_size_) - 1;
+  for (unsigned i = 0; i < num; i++) {
+    if (hashes[i] < this->theta_) CommonUtil::prefetch(&keys_[static_cast<uint32_t>(hashes[i]) & mask]);
+  }
+  for (unsigned i = 0; i < num; i++) internal_update(hashes[i]);
+}
+
 template<typename A>
 void update_theta_sketch_alloc<A>::trim() {
   if (num_keys_ > static_cast<uint32_t>(1 << lg_nom_size_)) rebuild();
 }
 
+template<typename A>
+void update_theta_sketch_alloc<A>::reset() {
+  this->is_empty_ = true;
+  this->theta_ = theta_sketch_alloc<A>::MAX_THETA;
+  if (p_ < 1) this->theta_ *= p_;
+  std::fill(keys_, &keys_[1 << lg_cur_size_], 0);
+  num_keys_ = 0;
+}
+
 template<typename A>
 void update_theta_sketch_alloc<A>::resize() {
   const uint32_t cur_size = 1 << lg_cur_size_;
@@ -618,32 +783,113 @@ void update_theta_sketch_alloc<A>::resize() {
   std::fill(new_keys, &new_keys[new_size], 0);
   for (uint32_t i = 0; i < cur_size; i++) {
     if (keys_[i] != 0) {
-      hash_search_or_insert(keys_[i], new_keys, lg_new_size); // TODO hash_insert
+      if (layout_ == STRIDED) {
+        hash_insert(keys_[i], new_keys, lg_new_size);
+      } else {
+        bucket_search_or_insert(keys_[i], new_keys, lg_new_size);
+      }
     }
   }
-  AllocU64().deallocate(keys_, cur_size);
+  deallocate_keys();
   keys_ = new_keys;
+  keys_offset_ = 0;
   lg_cur_size_ += factor;
   capacity_ = get_capacity(lg_cur_size_, lg_nom_size_);
 }
 
+template<typename A>
+void update_theta_sketch_alloc<A>::deallocate_keys() {
+  if (keys_ != nullptr) AllocU64().deallocate(keys_ - keys_offset_, (1 << lg_cur_size_) + keys_offset_);
+}
+
 template<typename A>
 void update_theta_sketch_alloc<A>::rebuild() {
   const uint32_t cur_size = 1 << lg_cur_size_;
   const uint32_t pivot = (1 << lg_nom_size_) + cur_size - num_keys_;
   std::nth_element(&keys_[0], &keys_[pivot], &keys_[cur_size]);
   this->theta_ = keys_[pivot];
-  uint64_t* new_keys = AllocU64().allocate(cur_size);
-  std::fill(new_keys, &new_keys[cur_size], 0);
   num_keys_ = 0;
   for (uint32_t i = 0; i < cur_size; i++) {
-    if (keys_[i] != 0 and keys_[i] < this->theta_) {
-      hash_search_or_insert(keys_[i], new_keys, lg_cur_size_); // TODO hash_insert
+    if (keys_[i] >= this->theta_) {
+      keys_[i] = 0;
+    } else if (keys_[i] != 0) {
       num_keys_++;
     }
   }
-  AllocU64().deallocate(keys_, cur_size);
-  keys_ = new_keys;
+  if (layout_ == STRIDED) {
+    rehash_strided_in_place();
+  } else {
+    rehash_bucketized_in_place();
+  }
+}
+
+// surviving keys are taken out of their current slots one by one,
+// and a key that lands on a slot still holding an unplaced key takes its place
+// and continues with the displaced one
+template<typename A>
+void update_theta_sketch_alloc<A>::rehash_strided_in_place() {
+  const uint32_t cur_size = 1 << lg_cur_size_;
+  const uint32_t mask = cur_size - 1;
+  for (uint32_t i = 0; i < cur_size; i++) {
+    if (keys_[i] == 0 or (keys_[i] & REBUILD_MARK)) continue;
+    uint64_t key = keys_[i];
+    keys_[i] = 0;
+    uint32_t cur_probe = static_cast<uint32_t>(key) & mask;
+    uint32_t stride = get_stride(key, lg_cur_size_);
+    while (true) {
+      const uint64_t value = keys_[cur_probe];
+      if (value == 0) {
+        keys_[cur_probe] = key | REBUILD_MARK;
+        break;
+      } else if (!(value & REBUILD_MARK)) {
+        keys_[cur_probe] = key | REBUILD_MARK;
+        key = value;
+        cur_probe = static_cast<uint32_t>(key) & mask;
+        stride = get_stride(key, lg_cur_size_);
+      } else {
+        cur_probe = (cur_probe + stride) & mask;
+      }
+    }
+  }
+  for (uint32_t i = 0; i < cur_size; i++) keys_[i] &= ~REBUILD_MARK;
+}
+
+// same as above, placed keys always form a prefix of their bucket,
+// so the first unmarked slot of a bucket is either empty or holds an unplaced key
+template<typename A>
+void update_theta_sketch_alloc<A>::rehash_bucketized_in_place() {
+  const uint32_t cur_size = 1 << lg_cur_size_;
+  const uint32_t mask = cur_size - 1;
+  for (uint32_t i = 0; i < cur_size; i++) {
+    if (keys_[i] == 0 or (keys_[i] & REBUILD_MARK)) continue;
+    uint64_t key = keys_[i];
+    keys_[i] = 0;
+    uint32_t cur_bucket = static_cast<uint32_t>(key) & mask & ~(BUCKET_SIZE - 1);
+    while (true) {
+      uint64_t* slots = &keys_[cur_bucket];
+      uint32_t j = 0;
+      while (j < BUCKET_SIZE and (slots[j] & REBUILD_MARK)) ++j;
+      if (j == BUCKET_SIZE) {
+        cur_bucket = (cur_bucket + BUCKET_SIZE) & mask;
+        continue;
+      }
+      const uint64_t value = slots[j];
+      slots[j] = key | REBUILD_MARK;
+      if (value == 0) break;
+      key = value;
+      cur_bucket = static_cast<uint32_t>(key) & mask & ~(BUCKET_SIZE - 1);
+    }
+  }
+  for (uint32_t i = 0; i < cur_size; i++) keys_[i] &= ~REBUILD_MARK;
+}
+
+template<typename A>
+void update_theta_sketch_alloc<A>::copy_strided(uint64_t* table) const {
+  const uint32_t cur_size = 1 << lg_cur_size_;
+  std::fill(table, &table[cur_size], 0);
+  for (uint32_t i = 0; i < cur_size; i++) {
+    if (keys_[i] != 0) hash_insert(keys_[i], table, lg_cur_size_);
+  }
 }
 
 template<typename A>
@@ -681,6 +927,22 @@ bool update_theta_sketch_alloc<A>::hash_search_or_insert(uint64_t hash, uint64_t
   throw std::logic_error("key not found and no empty slots!");
 }
 
+template<typename A>
+void update_theta_sketch_alloc<A>::hash_insert(uint64_t hash, uint64_t* table, uint8_t lg_size) {
+  const uint32_t mask = (1 << lg_size) - 1;
+  const uint32_t stride = get_stride(hash, lg_size);
+  uint32_t cur_probe = static_cast<uint32_t>(hash) & mask;
+  const uint32_t loop_index = cur_probe;
+  do {
+    if (table[cur_probe] == 0) {
+      table[cur_probe] = hash;
+      return;
+    }
+    cur_probe = (cur_probe + stride) & mask;
+  } while (cur_probe != loop_index);
+  throw std::logic_error("no empty slots!");
+}
+
 template<typename A>
 bool update_theta_sketch_alloc<A>::hash_search(uint64_t hash, const uint64_t* table, uint8_t lg_size) {
   const uint32_t mask = (1 << lg_size) - 1;
@@ -701,6 +963,27 @@ bool update_theta_sketch_alloc<A>::hash_search(uint64_t hash, const uint64_t* ta
   throw std::logic_error("key not found and search wrapped");
 }
 
+template<typename A>
+bool update_theta_sketch_alloc<A>::bucket_search_or_insert(uint64_t hash, uint64_t* table, uint8_t lg_size) {
+  const uint32_t mask = (1 << lg_size) - 1;
+  uint32_t cur_bucket = static_cast<uint32_t>(hash) & mask & ~(BUCKET_SIZE - 1);
+  const uint32_t loop_index = cur_bucket;
+  do {
+    uint64_t* slots = &table[cur_bucket];
+    // keys are not removed between rebuilds, so they fill a bucket from the start
+    // and the first empty slot ends the search
+    for (uint32_t i = 0; i < BUCKET_SIZE; i++) {
+      if (slots[i] == 0) {
+        slots[i] = hash;
+        return true;
+      }
+      if (slots[i] == hash) return false;
+    }
+    cur_bucket = (cur_bucket + BUCKET_SIZE) & mask;
+  } while (cur_bucket != loop_index);
+  throw std::logic_error("key not found and no empty slots!");
+}
+
 template<typename A>
 typename theta_sketch_alloc<A>::const_iterator update_theta_sketch_alloc<A>::begin() const {
   return typename theta_sketch_alloc<A>::const_iterator(keys_, 1 << lg_cur_size_, 0);
@@ -711,6 +994,16 @@ typename theta_sketch_alloc<A>::const_iterator update_theta_sketch_alloc<A>::end
   return typename theta_sketch_alloc<A>::const_iterator(keys_, 1 << lg_cur_size_, 1 << lg_cur_size_);
 }
 
+template<typename A>
+const uint64_t* update_theta_sketch_alloc<A>::get_keys() const {
+  return keys_;
+}
+
+template<typename A>
+uint32_t update_theta_sketch_alloc<A>::get_num_key_slots() const {
+  return 1 << lg_cur_size_;
+}
+
 // compact sketch
 
 template<typename A>
@@ -856,12 +1149,26 @@ void compact_theta_sketch_alloc<A>::serialize(std::ostream& os) const {
 
 template<typename A>
 vector_u8<A> compact_theta_sketch_alloc<A>::serialize(unsigned header_size_bytes) const {
-  const bool is_single_item = num_keys_ == 1 and !this->is_estimation_mode();
-  const uint8_t preamble_longs = this->is_empty() or is_single_item ? 1 : this->is_estimation_mode() ? 3 : 2;
+  const uint8_t preamble_longs = get_preamble_longs(this->is_empty(), this->theta_, num_keys_);
   const size_t size = header_size_bytes + sizeof(uint64_t) * preamble_longs + sizeof(uint64_t) * num_keys_;
   vector_u8<A> bytes(size);
-  uint8_t* ptr = bytes.data() + header_size_bytes;
+  uint8_t* ptr = write_preamble(bytes.data() + header_size_bytes, preamble_longs, this->is_empty(), this->theta_, num_keys_, get_seed_hash(), this->is_ordered());
+  if (!this->is_empty()) {
+    ptr += copy_to_mem(keys_, ptr, sizeof(uint64_t) * num_keys_);
+  }
+  return bytes;
+}
 
+template<typename A>
+uint8_t compact_theta_sketch_alloc<A>::get_preamble_longs(bool is_empty, uint64_t theta, uint32_t num_keys) {
+  const bool is_estimation_mode = theta < theta_sketch_alloc<A>::MAX_THETA and !is_empty;
+  const bool is_single_item = num_keys == 1 and !is_estimation_mode;
+  return is_empty or is_single_item ? 1 : is_estimation_mode ? 3 : 2;
+}
+
+template<typename A>
+uint8_t* compact_theta_sketch_alloc<A>::write_preamble(uint8_t* ptr, uint8_t preamble_longs, bool is_empty, uint64_t theta,
+    uint32_t num_keys, uint16_t seed_hash, bool is_ordered) {
   ptr += copy_to_mem(&preamble_longs, ptr, sizeof(preamble_longs));
   const uint8_t serial_version = theta_sketch_alloc<A>::SERIAL_VERSION;
   ptr += copy_to_mem(&serial_version, ptr, sizeof(serial_version));
@@ -872,25 +1179,32 @@ vector_u8<A> compact_theta_sketch_alloc<A>::serialize(unsigned header_size_bytes
   const uint8_t flags_byte(
     (1 << theta_sketch_alloc<A>::flags::IS_COMPACT) |
     (1 << theta_sketch_alloc<A>::flags::IS_READ_ONLY) |
-    (this->is_empty() ? 1 << theta_sketch_alloc<A>::flags::IS_EMPTY : 0) |
-    (this->is_ordered() ? 1 << theta_sketch_alloc<A>::flags::IS_ORDERED : 0)
+    (is_empty ? 1 << theta_sketch_alloc<A>::flags::IS_EMPTY : 0) |
+    (is_ordered ? 1 << theta_sketch_alloc<A>::flags::IS_ORDERED : 0)
   );
   ptr += copy_to_mem(&flags_byte, ptr, sizeof(flags_byte));
-  const uint16_t seed_hash = get_seed_hash();
   ptr += copy_to_mem(&seed_hash, ptr, sizeof(seed_hash));
-  if (!this->is_empty()) {
-    if (!is_single_item) {
-      ptr += copy_to_mem(&num_keys_, ptr, sizeof(num_keys_));
-      const uint32_t unused32 = 0;
-      ptr += copy_to_mem(&unused32, ptr, sizeof(unused32));
-      if (this->is_estimation_mode()) {
-        ptr += copy_to_mem(&(this->theta_), ptr, sizeof(uint64_t));
-      }
+  if (preamble_longs > 1) {
+    ptr += copy_to_mem(&num_keys, ptr, sizeof(num_keys));
+    const uint32_t unused32 = 0;
+    ptr += copy_to_mem(&unused32, ptr, sizeof(unused32));
+    if (preamble_longs > 2) {
+      ptr += copy_to_mem(&theta, ptr, sizeof(theta));
     }
-    ptr += copy_to_mem(keys_, ptr, sizeof(uint64_t) * num_keys_);
   }
+  return ptr;
+}
 
-  return bytes;
+template<typename A>
+size_t compact_theta_sketch_alloc<A>::serialize_in_place(uint8_t* ptr, bool is_empty, uint64_t theta, uint32_t num_keys,
+    uint16_t seed_hash, bool is_ordered) {
+  const uint8_t preamble_longs = get_preamble_longs(is_empty, theta, num_keys);
+  const size_t keys_size_bytes = sizeof(uint64_t) * num_keys;
+  if (sizeof(uint64_t) * preamble_longs != MAX_PREAMBLE_BYTES) {
+    std::memmove(ptr + sizeof(uint64_t) * preamble_longs, ptr + MAX_PREAMBLE_BYTES, keys_size_bytes);
+  }
+  write_preamble(ptr, preamble_longs, is_empty, theta, num_keys, seed_hash, is_ordered);
+  return sizeof(uint64_t) * preamble_longs + keys_size_bytes;
 }
 
 template<typename A>
@@ -901,15 +1215,20 @@ compact_theta_sketch_alloc<A> compact_theta_sketch_alloc<A>::deserialize(std::is
   is.read((char*)&serial_version, sizeof(serial_version));
   uint8_t type;
   is.read((char*)&type, sizeof(type));
-  uint16_t unused16;
-  is.read((char*)&unused16, sizeof(unused16));
+  uint8_t entry_bits; // unused in the regular format
+  is.read((char*)&entry_bits, sizeof(entry_bits));
+  uint8_t num_entries_bytes; // unused in the regular format
+  is.read((char*)&num_entries_bytes, sizeof(num_entries_bytes));
   uint8_t flags_byte;
   is.read((char*)&flags_byte, sizeof(flags_byte));
   uint16_t seed_hash;
   is.read((char*)&seed_hash, sizeof(seed_hash));
   theta_sketch_alloc<A>::check_sketch_type(type, SKETCH_TYPE);
-  theta_sketch_alloc<A>::check_serial_version(serial_version, theta_sketch_alloc<A>::SERIAL_VERSION);
+  if (serial_version != COMPRESSED_SERIAL_VERSION) theta_sketch_alloc<A>::check_serial_version(serial_version, theta_sketch_alloc<A>::SERIAL_VERSION);
   theta_sketch_alloc<A>::check_seed_hash(seed_hash, theta_sketch_alloc<A>::get_seed_hash(seed));
+  if (serial_version == COMPRESSED_SERIAL_VERSION) {
+    return internal_deserialize_compressed(is, preamble_longs, entry_bits, num_entries_bytes, flags_byte, seed_hash);
+  }
   return internal_deserialize(is, preamble_longs, flags_byte, seed_hash);
 }
 
@@ -950,15 +1269,20 @@ compact_theta_sketch_alloc<A> compact_theta_sketch_alloc<A>::deserialize(const v
   ptr += copy_from_mem(ptr, &serial_version, sizeof(serial_version));
   uint8_t type;
   ptr += copy_from_mem(ptr, &type, sizeof(type));
-  uint16_t unused16;
-  ptr += copy_from_mem(ptr, &unused16, sizeof(unused16));
+  uint8_t entry_bits; // unused in the regular format
+  ptr += copy_from_mem(ptr, &entry_bits, sizeof(entry_bits));
+  uint8_t num_entries_bytes; // unused in the regular format
+  ptr += copy_from_mem(ptr, &num_entries_bytes, sizeof(num_entries_bytes));
   uint8_t flags_byte;
   ptr += copy_from_mem(ptr, &flags_byte, sizeof(flags_byte));
   uint16_t seed_hash;
   ptr += copy_from_mem(ptr, &seed_hash, sizeof(seed_hash));
   theta_sketch_alloc<A>::check_sketch_type(type, SKETCH_TYPE);
-  theta_sketch_alloc<A>::check_serial_version(serial_version, theta_sketch_alloc<A>::SERIAL_VERSION);
+  if (serial_version != COMPRESSED_SERIAL_VERSION) theta_sketch_alloc<A>::check_serial_version(serial_version, theta_sketch_alloc<A>::SERIAL_VERSION);
   theta_sketch_alloc<A>::check_seed_hash(seed_hash, theta_sketch_alloc<A>::get_seed_hash(seed));
+  if (serial_version == COMPRESSED_SERIAL_VERSION) {
+    return internal_deserialize_compressed(ptr, size - (ptr - static_cast<const char*>(bytes)), preamble_longs, entry_bits, num_entries_bytes, flags_byte, seed_hash);
+  }
   return internal_deserialize(ptr, size - (ptr - static_cast<const char*>(bytes)), preamble_longs, flags_byte, seed_hash);
 }
 
@@ -995,6 +1319,158 @@ compact_theta_sketch_alloc<A> compact_theta_sketch_alloc<A>::internal_deserializ
   return compact_theta_sketch_alloc<A>(is_empty, theta, keys, num_keys, seed_hash, is_ordered);
 }
 
+template<typename A>
+bool compact_theta_sketch_alloc<A>::is_suitable_for_compression() const {
+  if (!is_ordered_ or num_keys_ == 0) return false;
+  return num_keys_ > 1 or this->is_estimation_mode();
+}
+
+template<typename A>
+uint8_t compact_theta_sketch_alloc<A>::compute_entry_bits() const {
+  // the number of significant bits in the largest delta between consecutive keys,
+  // one width for all the keys to keep the serial version 4 layout
+  uint64_t previous = 0;
+  uint64_t ored = 0;
+  for (uint32_t i = 0; i < num_keys_; i++) {
+    ored |= keys_[i] - previous;
+    previous = keys_[i];
+  }
+  uint8_t bits = 1;
+  while (bits < 64 and (ored >> bits) != 0) ++bits;
+  return bits;
+}
+
+template<typename A>
+uint8_t compact_theta_sketch_alloc<A>::get_num_entries_bytes(uint32_t num_entries) {
+  uint8_t num_bytes = 1;
+  while (num_bytes < sizeof(num_entries) and (num_entries >> (8 * num_bytes)) != 0) ++num_bytes;
+  return num_bytes;
+}
+
+template<typename A>
+size_t compact_theta_sketch_alloc<A>::get_compressed_serialized_size_bytes(uint8_t entry_bits, uint8_t num_entries_bytes) const {
+  const size_t preamble_bytes = this->is_estimation_mode() ? 16 : 8;
+  const size_t packed_bytes = (static_cast<size_t>(entry_bits) * num_keys_ + 7) / 8;
+  return preamble_bytes + num_entries_bytes + packed_bytes;
+}
+
+template<typename A>
+void compact_theta_sketch_alloc<A>::pack_keys(uint8_t entry_bits, uint8_t* ptr) const {
+  uint64_t deltas[8];
+  uint64_t previous = 0;
+  uint32_t i = 0;
+  for (; i + 8 <= num_keys_; i += 8) {
+    for (int j = 0; j < 8; j++) {
+      deltas[j] = keys_[i + j] - previous;
+      previous = keys_[i + j];
+    }
+    ptr = pack_bits_block8(deltas, entry_bits, ptr);
+  }
+  uint8_t offset = 0;
+  for (; i < num_keys_; i++) {
+    ptr = pack_bits(keys_[i] - previous, entry_bits, ptr, offset);
+    previous = keys_[i];
+  }
+}
+
+template<typename A>
+void compact_theta_sketch_alloc<A>::unpack_keys(uint64_t* keys, uint32_t num_keys, uint8_t entry_bits, const uint8_t* ptr) {
+  // blocks are independent, so decoding is separated from the sequential prefix sum
+  uint32_t i = 0;
+  for (; i + 8 <= num_keys; i += 8) ptr = unpack_bits_block8(&keys[i], entry_bits, ptr);
+  uint8_t offset = 0;
+  for (; i < num_keys; i++) ptr = unpack_bits(keys[i], entry_bits, ptr, offset);
+  for (i = 1; i < num_keys; i++) keys[i] += keys[i - 1];
+}
+
+template<typename A>
+void compact_theta_sketch_alloc<A>::serialize_compressed(std::ostream& os) const {
+  if (!is_suitable_for_compression()) return serialize(os);
+  const auto bytes = serialize_compressed(0);
+  os.write(reinterpret_cast<const char*>(bytes.data()), bytes.size());
+}
+
+template<typename A>
+vector_u8<A> compact_theta_sketch_alloc<A>::serialize_compressed(unsigned header_size_bytes) const {
+  if (!is_suitable_for_compression()) return serialize(header_size_bytes);
+  const uint8_t entry_bits = compute_entry_bits();
+  const uint8_t num_entries_bytes = get_num_entries_bytes(num_keys_);
+  const size_t size = header_size_bytes + get_compressed_serialized_size_bytes(entry_bits, num_entries_bytes);
+  vector_u8<A> bytes(size);
+  uint8_t* ptr = bytes.data() + header_size_bytes;
+
+  const uint8_t preamble_longs = this->is_estimation_mode() ? 2 : 1;
+  ptr += copy_to_mem(&preamble_longs, ptr, sizeof(preamble_longs));
+  const uint8_t serial_version = COMPRESSED_SERIAL_VERSION;
+  ptr += copy_to_mem(&serial_version, ptr, sizeof(serial_version));
+  const uint8_t type = SKETCH_TYPE;
+  ptr += copy_to_mem(&type, ptr, sizeof(type));
+  ptr += copy_to_mem(&entry_bits, ptr, sizeof(entry_bits));
+  ptr += copy_to_mem(&num_entries_bytes, ptr, sizeof(num_entries_bytes));
+  const uint8_t flags_byte(
+    (1 << theta_sketch_alloc<A>::flags::IS_COMPACT) |
+    (1 << theta_sketch_alloc<A>::flags::IS_READ_ONLY) |
+    (1 << theta_sketch_alloc<A>::flags::IS_ORDERED)
+  );
+  ptr += copy_to_mem(&flags_byte, ptr, sizeof(flags_byte));
+  const uint16_t seed_hash = get_seed_hash();
+  ptr += copy_to_mem(&seed_hash, ptr, sizeof(seed_hash));
+  if (this->is_estimation_mode()) {
+    ptr += copy_to_mem(&(this->theta_), ptr, sizeof(uint64_t));
+  }
+  // little-endian entry count using the minimal number of bytes
+  for (uint8_t i = 0; i < num_entries_bytes; i++) *ptr++ = static_cast<uint8_t>(num_keys_ >> (8 * i));
+  pack_keys(entry_bits, ptr);
+  return bytes;
+}
+
+template<typename A>
+compact_theta_sketch_alloc<A> compact_theta_sketch_alloc<A>::internal_deserialize_compressed(std::istream& is, uint8_t preamble_longs,
+    uint8_t entry_bits, uint8_t num_entries_bytes, uint8_t flags_byte, uint16_t seed_hash) {
+  if (entry_bits == 0 or entry_bits > 64) throw std::invalid_argument("invalid entry bits " + std::to_string((int) entry_bits));
+  if (num_entries_bytes == 0 or num_entries_bytes > 4) throw std::invalid_argument("invalid number of entries bytes " + std::to_string((int) num_entries_bytes));
+  uint64_t theta = theta_sketch_alloc<A>::MAX_THETA;
+  if (preamble_longs > 1) {
+    is.read((char*)&theta, sizeof(theta));
+  }
+  uint32_t num_keys = 0;
+  for (uint8_t i = 0; i < num_entries_bytes; i++) {
+    uint8_t byte;
+    is.read((char*)&byte, sizeof(byte));
+    num_keys |= static_cast<uint32_t>(byte) << (8 * i);
+  }
+  vector_u8<A> packed((static_cast<size_t>(entry_bits) * num_keys + 7) / 8);
+  is.read((char*)packed.data(), packed.size());
+  typedef typename std::allocator_traits<A>::template rebind_alloc<uint64_t> AllocU64;
+  uint64_t* keys = AllocU64().allocate(num_keys);
+  unpack_keys(keys, num_keys, entry_bits, packed.data());
+  const bool is_empty = flags_byte & (1 << theta_sketch_alloc<A>::flags::IS_EMPTY);
+  return compact_theta_sketch_alloc<A>(is_empty, theta, keys, num_keys, seed_hash, true);
+}
+
+template<typename A>
+compact_theta_sketch_alloc<A> compact_theta_sketch_alloc<A>::internal_deserialize_compressed(const void* bytes, size_t size, uint8_t preamble_longs,
+    uint8_t entry_bits, uint8_t num_entries_bytes, uint8_t flags_byte, uint16_t seed_hash) {
+  if (entry_bits == 0 or entry_bits > 64) throw std::invalid_argument("invalid entry bits " + std::to_string((int) entry_bits));
+  if (num_entries_bytes == 0 or num_entries_bytes > 4) throw std::invalid_argument("invalid number of entries bytes " + std::to_string((int) num_entries_bytes));
+  const uint8_t* ptr = static_cast<const uint8_t*>(bytes);
+  uint64_t theta = theta_sketch_alloc<A>::MAX_THETA;
+  if (preamble_longs > 1) {
+    theta_sketch_alloc<A>::check_size(size, 8);
+    ptr += copy_from_mem(ptr, &theta, sizeof(theta));
+  }
+  theta_sketch_alloc<A>::check_size(size - (ptr - static_cast<const uint8_t*>(bytes)), num_entries_bytes);
+  uint32_t num_keys = 0;
+  for (uint8_t i = 0; i < num_entries_bytes; i++) num_keys |= static_cast<uint32_t>(*ptr++) << (8 * i);
+  const size_t packed_size_bytes = (static_cast<size_t>(entry_bits) * num_keys + 7) / 8;
+  theta_sketch_alloc<A>::check_size(size - (ptr - static_cast<const uint8_t*>(bytes)), packed_size_bytes);
+  typedef typename std::allocator_traits<A>::template rebind_alloc<uint64_t> AllocU64;
+  uint64_t* keys = AllocU64().allocate(num_keys);
+  unpack_keys(keys, num_keys, entry_bits, ptr);
+  const bool is_empty = flags_byte & (1 << theta_sketch_alloc<A>::flags::IS_EMPTY);
+  return compact_theta_sketch_alloc<A>(is_empty, theta, keys, num_keys, seed_hash, true);
+}
+
 template<typename A>
 typename theta_sketch_alloc<A>::const_iterator compact_theta_sketch_alloc<A>::begin() const {
   return typename theta_sketch_alloc<A>::const_iterator(keys_, num_keys_, 0);
@@ -1005,11 +1481,208 @@ typename theta_sketch_alloc<A>::const_iterator compact_theta_sketch_alloc<A>::en
   return typename theta_sketch_alloc<A>::const_iterator(keys_, num_keys_, num_keys_);
 }
 
+template<typename A>
+const uint64_t* compact_theta_sketch_alloc<A>::get_keys() const {
+  return keys_;
+}
+
+template<typename A>
+uint32_t compact_theta_sketch_alloc<A>::get_num_key_slots() const {
+  return num_keys_;
+}
+
+// wrapped compact sketch
+
+template<typename A>
+wrapped_compact_theta_sketch_alloc<A>::wrapped_compact_theta_sketch_alloc(bool is_empty, uint64_t theta, const void* bytes, size_t size_bytes,
+    const uint64_t* keys, uint32_t num_keys, uint16_t seed_hash, bool is_ordered):
+theta_sketch_alloc<A>(is_empty, theta),
+bytes_(bytes),
+size_bytes_(size_bytes),
+keys_(keys),
+num_keys_(num_keys),
+seed_hash_(seed_hash),
+is_ordered_(is_ordered)
+{}
+
+template<typename A>
+uint32_t wrapped_compact_theta_sketch_alloc<A>::get_num_retained() const {
+  return num_keys_;
+}
+
+template<typename A>
+uint16_t wrapped_compact_theta_sketch_alloc<A>::get_seed_hash() const {
+  return seed_hash_;
+}
+
+template<typename A>
+bool wrapped_compact_theta_sketch_alloc<A>::is_ordered() const {
+  return is_ordered_;
+}
+
+template<typename A>
+void wrapped_compact_theta_sketch_alloc<A>::to_stream(std::ostream& os, bool print_items) const {
+  os << "### Wrapped compact Theta sketch summary:" << std::endl;
+  os << "   num retained keys    : " << num_keys_ << std::endl;
+  os << "   seed hash            : " << this->get_seed_hash() << std::endl;
+  os << "   ordered?             : " << (this->is_ordered() ? "true" : "false") << std::endl;
+  os << "   theta (fraction)     : " << this->get_theta() << std::endl;
+  os << "   theta (raw 64-bit)   : " << this->theta_ << std::endl;
+  os << "   estimation mode?     : " << (this->is_estimation_mode() ? "true" : "false") << std::endl;
+  os << "   estimate             : " << this->get_estimate() << std::endl;
+  os << "   lower bound 95% conf : " << this->get_lower_bound(2) << std::endl;
+  os << "   upper bound 95% conf : " << this->get_upper_bound(2) << std::endl;
+  os << "### End sketch summary" << std::endl;
+  if (print_items) {
+    os << "### Retained keys" << std::endl;
+    for (auto key: *this) os << "   " << key << std::endl;
+    os << "### End retained keys" << std::endl;
+  }
+}
+
+template<typename A>
+void wrapped_compact_theta_sketch_alloc<A>::serialize(std::ostream& os) const {
+  os.write(static_cast<const char*>(bytes_), size_bytes_);
+}
+
+template<typename A>
+vector_u8<A> wrapped_compact_theta_sketch_alloc<A>::serialize(unsigned header_size_bytes) const {
+  vector_u8<A> bytes(header_size_bytes + size_bytes_);
+  copy_to_mem(bytes_, bytes.data() + header_size_bytes, size_bytes_);
+  return bytes;
+}
+
+template<typename A>
+typename theta_sketch_alloc<A>::const_iterator wrapped_compact_theta_sketch_alloc<A>::begin() const {
+  return typename theta_sketch_alloc<A>::const_iterator(keys_, num_keys_, 0);
+}
+
+template<typename A>
+typename theta_sketch_alloc<A>::const_iterator wrapped_compact_theta_sketch_alloc<A>::end() const {
+  return typename theta_sketch_alloc<A>::const_iterator(keys_, num_keys_, num_keys_);
+}
+
+template<typename A>
+const uint64_t* wrapped_compact_theta_sketch_alloc<A>::get_keys() const {
+  return keys_;
+}
+
+template<typename A>
+uint32_t wrapped_compact_theta_sketch_alloc<A>::get_num_key_slots() const {
+  return num_keys_;
+}
+
+template<typename A>
+wrapped_compact_theta_sketch_alloc<A> wrapped_compact_theta_sketch_alloc<A>::wrap(const void* bytes, size_t size, uint64_t seed) {
+  theta_sketch_alloc<A>::check_size(size, 8);
+  const char* ptr = static_cast<const char*>(bytes);
+  uint8_t preamble_longs;
+  ptr += copy_from_mem(ptr, &preamble_longs, sizeof(preamble_longs));
+  uint8_t serial_version;
+  ptr += copy_from_mem(ptr, &serial_version, sizeof(serial_version));
+  uint8_t type;
+  ptr += copy_from_mem(ptr, &type, sizeof(type));
+  uint16_t unused16;
+  ptr += copy_from_mem(ptr, &unused16, sizeof(unused16));
+  uint8_t flags_byte;
+  ptr += copy_from_mem(ptr, &flags_byte, sizeof(flags_byte));
+  uint16_t seed_hash;
+  ptr += copy_from_mem(ptr, &seed_hash, sizeof(seed_hash));
+  theta_sketch_alloc<A>::check_sketch_type(type, compact_theta_sketch_alloc<A>::SKETCH_TYPE);
+  theta_sketch_alloc<A>::check_serial_version(serial_version, theta_sketch_alloc<A>::SERIAL_VERSION);
+  theta_sketch_alloc<A>::check_seed_hash(seed_hash, theta_sketch_alloc<A>::get_seed_hash(seed));
+
+  uint64_t theta = theta_sketch_alloc<A>::MAX_THETA;
+  uint32_t num_keys = 0;
+  const bool is_empty = flags_byte & (1 << theta_sketch_alloc<A>::flags::IS_EMPTY);
+  if (!is_empty) {
+    if (preamble_longs == 1) {
+      num_keys = 1;
+    } else {
+      theta_sketch_alloc<A>::check_size(size - (ptr - static_cast<const char*>(bytes)), 8);
+      ptr += copy_from_mem(ptr, &num_keys, sizeof(num_keys));
+      uint32_t unused32;
+      ptr += copy_from_mem(ptr, &unused32, sizeof(unused32));
+      if (preamble_longs > 2) {
+        theta_sketch_alloc<A>::check_size(size - (ptr - static_cast<const char*>(bytes)), 8);
+        ptr += copy_from_mem(ptr, &theta, sizeof(theta));
+      }
+    }
+    theta_sketch_alloc<A>::check_size(size - (ptr - static_cast<const char*>(bytes)), sizeof(uint64_t) * num_keys);
+  }
+  if (num_keys > 0 and reinterpret_cast<uintptr_t>(ptr) % alignof(uint64_t) != 0) throw std::invalid_argument("keys are not 8-byte aligned");
+  const uint64_t* keys = reinterpret_cast<const uint64_t*>(ptr);
+  const size_t size_bytes = (ptr - static_cast<const char*>(bytes)) + sizeof(uint64_t) * num_keys;
+  const bool is_ordered = flags_byte & (1 << theta_sketch_alloc<A>::flags::IS_ORDERED);
+  return wrapped_compact_theta_sketch_alloc<A>(is_empty, theta, bytes, size_bytes, keys, num_keys, seed_hash, is_ordered);
+}
+
+template<typename A>
+compact_theta_sketch_alloc<A> compact_theta_sketch_alloc<A>::from_hashes(const uint64_t* hashes, size_t num, uint8_t lg_k, float p, uint64_t seed) {
+  if (lg_k < update_theta_sketch_alloc<A>::builder::MIN_LG_K) {
+    throw std::invalid_argument("lg_k must not be less than " + std::to_string(update_theta_sketch_alloc<A>::builder::MIN_LG_K) + ": " + std::to_string(lg_k));
+  }
+  uint64_t theta = theta_sketch_alloc<A>::MAX_THETA;
+  if (p < 1) theta *= p;
+  const uint32_t nom_num_keys = 1 << lg_k;
+  vector_u64 keys;
+  if (std::is_sorted(hashes, &hashes[num])) {
+    keys.reserve(std::min(num, static_cast<size_t>(nom_num_keys)));
+    for (size_t i = 0; i < num and hashes[i] < theta; i++) {
+      if (hashes[i] == 0 or (!keys.empty() and keys.back() == hashes[i])) continue;
+      if (keys.size() == nom_num_keys) {
+        theta = hashes[i];
+        break;
+      }
+      keys.push_back(hashes[i]);
+    }
+  } else {
+    for (size_t i = 0; i < num; i++) {
+      if (hashes[i] != 0 and hashes[i] < theta) keys.push_back(hashes[i]);
+    }
+    select_smallest_distinct(keys, nom_num_keys);
+    if (keys.size() > nom_num_keys) {
+      theta = keys.back();
+      keys.pop_back();
+    }
+  }
+  uint64_t* result_keys = nullptr;
+  if (!keys.empty()) {
+    result_keys = AllocU64().allocate(keys.size());
+    std::copy(keys.begin(), keys.end(), result_keys);
+  }
+  return compact_theta_sketch_alloc<A>(num == 0, theta, result_keys, keys.size(), theta_sketch_alloc<A>::get_seed_hash(seed), true);
+}
+
+template<typename A>
+void compact_theta_sketch_alloc<A>::select_smallest_distinct(vector_u64& keys, uint32_t num) {
+  // the sorted distinct prefix grows by selecting just enough of the smallest remaining keys,
+  // after which the remaining keys not above the prefix are dropped
+  // (more than one round is needed only if the selected keys had duplicates)
+  uint64_t* data = keys.data();
+  size_t num_selected = 0;
+  size_t end = keys.size();
+  while (num_selected < end) {
+    const size_t last = std::min(end, static_cast<size_t>(num) + 1);
+    if (last < end) std::nth_element(data + num_selected, data + last - 1, data + end);
+    std::sort(data + num_selected, data + last);
+    num_selected = std::unique(data + num_selected, data + last) - data;
+    if (num_selected == num + 1) break;
+    const uint64_t max_key = data[num_selected - 1];
+    size_t j = num_selected;
+    for (size_t i = last; i < end; i++) {
+      if (data[i] > max_key) data[j++] = data[i];
+    }
+    end = j;
+  }
+  keys.resize(num_selected);
+}
+
 // builder
 
 template<typename A>
 update_theta_sketch_alloc<A>::builder::builder():
-lg_k_(DEFAULT_LG_K), rf_(DEFAULT_RESIZE_FACTOR), p_(1), seed_(DEFAULT_SEED) {}
+lg_k_(DEFAULT_LG_K), rf_(DEFAULT_RESIZE_FACTOR), p_(1), seed_(DEFAULT_SEED), layout_(DEFAULT_TABLE_LAYOUT) {}
 
 template<typename A>
 typename update_theta_sketch_alloc<A>::builder& update_theta_sketch_alloc<A>::builder::set_lg_k(uint8_t lg_k) {
@@ -1038,6 +1711,12 @@ typename update_theta_sketch_alloc<A>::builder& update_theta_sketch_alloc<A>::bu
   return *this;
 }
 
+template<typename A>
+typename update_theta_sketch_alloc<A>::builder& update_theta_sketch_alloc<A>::builder::set_table_layout(table_layout layout) {
+  layout_ = layout;
+  return *this;
+}
+
 template<typename A>
 uint8_t update_theta_sketch_alloc<A>::builder::starting_sub_multiple(uint8_t lg_tgt, uint8_t lg_min, uint8_t lg_rf) {
   return (lg_tgt <= lg_min) ? lg_min : (lg_rf == 0) ? lg_tgt : ((lg_tgt - lg_min) % lg_rf) + lg_min;
@@ -1045,7 +1724,7 @@ uint8_t update_theta_sketch_alloc<A>::builder::starting_sub_multiple(uint8_t lg_
 
 template<typename A>
 update_theta_sketch_alloc<A> update_theta_sketch_alloc<A>::builder::build() const {
-  return update_theta_sketch_alloc<A>(starting_sub_multiple(lg_k_ + 1, MIN_LG_K, static_cast<uint8_t>(rf_)), lg_k_, rf_, p_, seed_);
+  return update_theta_sketch_alloc<A>(starting_sub_multiple(lg_k_ + 1, MIN_LG_K, static_cast<uint8_t>(rf_)), lg_k_, rf_, p_, seed_, layout_);
 }
 
 // iterator
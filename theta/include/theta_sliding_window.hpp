@@ -0,0 +1,82 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+
+#ifndef THETA_SLIDING_WINDOW_HPP_
+#define THETA_SLIDING_WINDOW_HPP_
+
+#include <memory>
+#include <vector>
+
+#include <theta_union.hpp>
+
+namespace datasketches {
+
+/*
+ * Sliding window over the most recent buckets (for instance minutes) of theta sketches.
+ * Besides the buckets themselves, unions of aligned spans of 2, 4, 8... buckets
+ * are kept as ordered compact sketches and computed once as the buckets arrive
+ * (amortized one union per bucket).
+ * A query for the last N buckets is covered by at most 2 * log2(N) such spans,
+ * which are merged by theta_union_alloc::merge_ordered().
+ */
+
+template<typename A>
+class theta_sliding_window_alloc {
+public:
+  // window_size is the maximum number of most recent buckets that can be queried
+  explicit theta_sliding_window_alloc(uint32_t window_size,
+      uint8_t lg_k = update_theta_sketch_alloc<A>::builder::DEFAULT_LG_K,
+      uint64_t seed = update_theta_sketch_alloc<A>::builder::DEFAULT_SEED);
+
+  // appends the sketch of the next bucket (possibly empty), the oldest bucket leaves the window
+  void add_bucket(const theta_sketch_alloc<A>& sketch);
+
+  // union of the last num_buckets buckets (or fewer if not added yet), always ordered
+  compact_theta_sketch_alloc<A> get_result(uint32_t num_buckets) const;
+
+  uint32_t get_window_size() const;
+
+  // number of buckets that can be queried so far
+  uint32_t get_num_buckets() const;
+
+private:
+  typedef typename std::allocator_traits<A>::template rebind_alloc<compact_theta_sketch_alloc<A>> AllocCompact;
+  typedef std::vector<compact_theta_sketch_alloc<A>, AllocCompact> vector_compact;
+  typedef typename std::allocator_traits<A>::template rebind_alloc<vector_compact> AllocVectorCompact;
+
+  uint32_t window_size_;
+  uint64_t num_added_;
+  theta_union_alloc<A> union_; // kept empty, used for merge_ordered()
+  uint16_t seed_hash_;
+  // level L is a ring of unions of 2^L buckets starting at multiples of 2^L
+  std::vector<vector_compact, AllocVectorCompact> levels_;
+
+  compact_theta_sketch_alloc<A>& get_span(uint8_t lg_span, uint64_t start);
+  const compact_theta_sketch_alloc<A>& get_span(uint8_t lg_span, uint64_t start) const;
+};
+
+// alias with default allocator for convenience
+typedef theta_sliding_window_alloc<std::allocator<void>> theta_sliding_window;
+
+} /* namespace datasketches */
+
+#include "theta_sliding_window_impl.hpp"
+
+#endif
@@ -0,0 +1,108 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+
+#ifndef THETA_SLIDING_WINDOW_IMPL_HPP_
+#define THETA_SLIDING_WINDOW_IMPL_HPP_
+
+#include <algorithm>
+
+namespace datasketches {
+
+template<typename A>
+theta_sliding_window_alloc<A>::theta_sliding_window_alloc(uint32_t window_size, uint8_t lg_k, uint64_t seed):
+window_size_(window_size),
+num_added_(0),
+union_(typename theta_union_alloc<A>::builder().set_lg_k(lg_k).set_seed(seed).build()),
+seed_hash_(0),
+levels_()
+{
+  if (window_size == 0) throw std::invalid_argument("window size must be positive");
+  const compact_theta_sketch_alloc<A> empty = union_.get_result();
+  seed_hash_ = empty.get_seed_hash();
+  // a ring one span longer than the window at each level, so that the span being computed
+  // never replaces one that is still needed
+  for (uint8_t lg_span = 0; (static_cast<uint64_t>(1) << lg_span) <= window_size; ++lg_span) {
+    levels_.push_back(vector_compact((window_size >> lg_span) + 1, empty));
+  }
+}
+
+template<typename A>
+void theta_sliding_window_alloc<A>::add_bucket(const theta_sketch_alloc<A>& sketch) {
+  if (!sketch.is_empty() and sketch.get_seed_hash() != seed_hash_) throw std::invalid_argument("seed hash mismatch");
+  const uint64_t index = num_added_;
+  get_span(0, index) = compact_theta_sketch_alloc<A>(sketch, true);
+  ++num_added_;
+  // the bucket completes spans at all levels where the next index is aligned
+  for (uint8_t lg_span = 1; lg_span < levels_.size(); ++lg_span) {
+    const uint64_t span = static_cast<uint64_t>(1) << lg_span;
+    if (num_added_ % span != 0) break;
+    const uint64_t start = num_added_ - span;
+    const theta_sketch_alloc<A>* halves[2] = { &get_span(lg_span - 1, start), &get_span(lg_span - 1, start + span / 2) };
+    get_span(lg_span, start) = union_.merge_ordered(halves, &halves[2]);
+  }
+}
+
+template<typename A>
+compact_theta_sketch_alloc<A> theta_sliding_window_alloc<A>::get_result(uint32_t num_buckets) const {
+  if (num_buckets > window_size_) throw std::invalid_argument("number of buckets exceeds the window size");
+  const uint64_t end = num_added_;
+  uint64_t start = end - std::min(static_cast<uint64_t>(num_buckets), num_added_);
+  // greedy cover by the largest aligned spans: sizes go up and then down
+  typedef typename std::allocator_traits<A>::template rebind_alloc<const theta_sketch_alloc<A>*> AllocPtr;
+  std::vector<const theta_sketch_alloc<A>*, AllocPtr> spans;
+  spans.reserve(2 * levels_.size());
+  while (start < end) {
+    uint8_t lg_span = 0;
+    while (lg_span + 1u < levels_.size()) {
+      const uint64_t next_span = static_cast<uint64_t>(1) << (lg_span + 1);
+      if (start % next_span != 0 or start + next_span > end) break;
+      ++lg_span;
+    }
+    spans.push_back(&get_span(lg_span, start));
+    start += static_cast<uint64_t>(1) << lg_span;
+  }
+  return union_.merge_ordered(spans.begin(), spans.end());
+}
+
+template<typename A>
+uint32_t theta_sliding_window_alloc<A>::get_window_size() const {
+  return window_size_;
+}
+
+template<typename A>
+uint32_t theta_sliding_window_alloc<A>::get_num_buckets() const {
+  return static_cast<uint32_t>(std::min(static_cast<uint64_t>(window_size_), num_added_));
+}
+
+template<typename A>
+compact_theta_sketch_alloc<A>& theta_sliding_window_alloc<A>::get_span(uint8_t lg_span, uint64_t start) {
+  vector_compact& level = levels_[lg_span];
+  return level[(start >> lg_span) % level.size()];
+}
+
+template<typename A>
+const compact_theta_sketch_alloc<A>& theta_sliding_window_alloc<A>::get_span(uint8_t lg_span, uint64_t start) const {
+  const vector_compact& level = levels_[lg_span];
+  return level[(start >> lg_span) % level.size()];
+}
+
+} /* namespace datasketches */
+
+#endif
@@ -0,0 +1,77 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+#ifndef THETA_SORTED_MERGE_HPP_
+#define THETA_SORTED_MERGE_HPP_
+
+#include <memory>
+#include <vector>
+
+#include <theta_sketch.hpp>
+
+namespace datasketches {
+
+// Traverses the keys below a given theta of several sketches at once in ascending order
+// using a min-heap of the next key of each sketch. Keys present in several sketches
+// come out once per sketch, next to each other.
+// Unordered sketches are traversed through sorted copies owned by this object.
+// The sketches added must outlive it.
+template<typename A>
+class theta_sorted_merge_alloc {
+public:
+  // max_sketches bounds the number of sketches to be added
+  theta_sorted_merge_alloc(uint64_t theta, uint32_t max_sketches);
+
+  // adds a sketch identified by the given id, unless it has no keys below theta
+  void add(const theta_sketch_alloc<A>& sketch, uint32_t id);
+
+  bool is_empty() const;
+
+  // the smallest key not yet traversed
+  uint64_t get_key() const;
+
+  // the id of a sketch that key comes from
+  uint32_t get_id() const;
+
+  // moves past the current key in the sketch it comes from
+  void next();
+
+private:
+  typedef typename theta_sketch_alloc<A>::const_iterator key_iterator;
+  struct cursor {
+    key_iterator it;
+    key_iterator end;
+    uint32_t id;
+  };
+  typedef std::pair<uint64_t, uint32_t> heap_entry; // key and cursor index
+  typedef typename std::allocator_traits<A>::template rebind_alloc<compact_theta_sketch_alloc<A>> AllocCompact;
+  typedef typename std::allocator_traits<A>::template rebind_alloc<cursor> AllocCursor;
+  typedef typename std::allocator_traits<A>::template rebind_alloc<heap_entry> AllocHeapEntry;
+
+  uint64_t theta_;
+  std::vector<compact_theta_sketch_alloc<A>, AllocCompact> sorted_copies_; // must not be relocated
+  std::vector<cursor, AllocCursor> cursors_;
+  std::vector<heap_entry, AllocHeapEntry> heap_;
+};
+
+} /* namespace datasketches */
+
+#include "theta_sorted_merge_impl.hpp"
+
+#endif
@@ -0,0 +1,81 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+#ifndef THETA_SORTED_MERGE_IMPL_HPP_
+#define THETA_SORTED_MERGE_IMPL_HPP_
+
+#include <algorithm>
+#include <functional>
+
+namespace datasketches {
+
+template<typename A>
+theta_sorted_merge_alloc<A>::theta_sorted_merge_alloc(uint64_t theta, uint32_t max_sketches):
+theta_(theta)
+{
+  sorted_copies_.reserve(max_sketches);
+  cursors_.reserve(max_sketches);
+  heap_.reserve(max_sketches);
+}
+
+template<typename A>
+void theta_sorted_merge_alloc<A>::add(const theta_sketch_alloc<A>& sketch, uint32_t id) {
+  if (sketch.is_empty() or sketch.get_num_retained() == 0) return;
+  const theta_sketch_alloc<A>* sorted = &sketch;
+  if (!sketch.is_ordered()) {
+    sorted_copies_.push_back(compact_theta_sketch_alloc<A>(sketch, true));
+    sorted = &sorted_copies_.back();
+  }
+  if (*sorted->begin() >= theta_) return;
+  heap_.push_back(heap_entry(*sorted->begin(), cursors_.size()));
+  std::push_heap(heap_.begin(), heap_.end(), std::greater<heap_entry>());
+  const cursor c = {sorted->begin(), sorted->end(), id};
+  cursors_.push_back(c);
+}
+
+template<typename A>
+bool theta_sorted_merge_alloc<A>::is_empty() const {
+  return heap_.empty();
+}
+
+template<typename A>
+uint64_t theta_sorted_merge_alloc<A>::get_key() const {
+  return heap_.front().first;
+}
+
+template<typename A>
+uint32_t theta_sorted_merge_alloc<A>::get_id() const {
+  return cursors_[heap_.front().second].id;
+}
+
+template<typename A>
+void theta_sorted_merge_alloc<A>::next() {
+  std::pop_heap(heap_.begin(), heap_.end(), std::greater<heap_entry>());
+  cursor& c = cursors_[heap_.back().second];
+  if (++c.it != c.end and *c.it < theta_) {
+    heap_.back().first = *c.it;
+    std::push_heap(heap_.begin(), heap_.end(), std::greater<heap_entry>());
+  } else {
+    heap_.pop_back();
+  }
+}
+
+} /* namespace datasketches */
+
+#endif
@@ -25,6 +25,7 @@
 #include <climits>
 
 #include <theta_sketch.hpp>
+#include <theta_sorted_merge.hpp>
 
 namespace datasketches {
 
@@ -41,11 +42,31 @@ public:
   void update(const theta_sketch_alloc<A>& sketch);
   compact_theta_sketch_alloc<A> get_result(bool ordered = true) const;
 
+  // Writes the result into a caller-supplied 8-byte aligned buffer in the serialized compact format,
+  // which can be used in place by wrapped_compact_theta_sketch_alloc::wrap() without allocation.
+  // The buffer must have at least get_max_result_size_bytes() bytes.
+  // Returns the number of bytes written.
+  size_t get_result(void* bytes, size_t size, bool ordered = true) const;
+  size_t get_max_result_size_bytes() const;
+
+  // returns to the initial empty state, keeping the allocated hash table
+  void reset();
+
+  // Computes the union of the current state and a range of sketches (or pointers to sketches)
+  // by k-way merge of their ordered keys instead of updating the hash table key by key.
+  // The state of this union is not modified. The result is always ordered.
+  // Intended for ordered compact sketches, other inputs are compacted and sorted first.
+  template<typename Iterator>
+  compact_theta_sketch_alloc<A> merge_ordered(Iterator first, Iterator last) const;
+
 private:
   bool is_empty_;
   uint64_t theta_;
   update_theta_sketch_alloc<A> state_;
 
+  // copies the keys in [1, theta) to out without branching, returns the number of keys copied
+  static unsigned filter_keys(const uint64_t* keys, unsigned num, uint64_t theta, uint64_t* out);
+
   // for builder
   theta_union_alloc(uint64_t theta, update_theta_sketch_alloc<A>&& state);
 };
@@ -56,10 +77,12 @@ template<typename A>
 class theta_union_alloc<A>::builder {
 public:
   typedef typename update_theta_sketch_alloc<A>::resize_factor resize_factor;
+  typedef typename update_theta_sketch_alloc<A>::table_layout table_layout;
   builder& set_lg_k(uint8_t lg_k);
   builder& set_resize_factor(resize_factor rf);
   builder& set_p(float p);
   builder& set_seed(uint64_t seed);
+  builder& set_table_layout(table_layout layout);
   theta_union_alloc<A> build() const;
 private:
   typename update_theta_sketch_alloc<A>::builder sketch_builder;
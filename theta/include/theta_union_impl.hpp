@@ -20,6 +20,10 @@
 #ifndef THETA_UNION_IMPL_HPP_
 #define THETA_UNION_IMPL_HPP_
 
+#include <algorithm>
+#include <functional>
+#include <vector>
+
 namespace datasketches {
 
 /*
@@ -44,11 +48,32 @@ void theta_union_alloc<A>::update(const theta_sketch_alloc<A>& sketch) {
       state_.internal_update(hash);
     }
   } else {
-    for (auto hash: sketch) if (hash < theta_) state_.internal_update(hash);
+    // Once theta has dropped most keys are rejected, so the raw key array (including empty slots
+    // of hash tables) is filtered without branches into a small buffer, and the survivors
+    // are inserted as a batch with prefetching.
+    const uint64_t* keys = sketch.get_keys();
+    const uint32_t num_keys = sketch.get_num_key_slots();
+    const unsigned batch_size = update_theta_sketch_alloc<A>::BATCH_SIZE;
+    uint64_t hashes[batch_size];
+    for (uint32_t i = 0; i < num_keys; i += batch_size) {
+      const unsigned num_hashes = filter_keys(&keys[i], std::min(num_keys - i, batch_size), theta_, hashes);
+      state_.internal_update(hashes, num_hashes);
+    }
   }
   if (state_.get_theta64() < theta_) theta_ = state_.get_theta64();
 }
 
+template<typename A>
+unsigned theta_union_alloc<A>::filter_keys(const uint64_t* keys, unsigned num, uint64_t theta, uint64_t* out) {
+  unsigned count = 0;
+  for (unsigned i = 0; i < num; i++) {
+    const uint64_t key = keys[i];
+    out[count] = key;
+    count += key - 1 < theta - 1; // zero wraps around and is rejected
+  }
+  return count;
+}
+
 template<typename A>
 compact_theta_sketch_alloc<A> theta_union_alloc<A>::get_result(bool ordered) const {
   if (is_empty_) return state_.compact(ordered);
@@ -77,6 +102,86 @@ compact_theta_sketch_alloc<A> theta_union_alloc<A>::get_result(bool ordered) con
   return compact_theta_sketch_alloc<A>(false, theta, keys, num_keys, state_.get_seed_hash(), ordered);
 }
 
+template<typename A>
+size_t theta_union_alloc<A>::get_result(void* bytes, size_t size, bool ordered) const {
+  if (size < get_max_result_size_bytes()) throw std::invalid_argument("buffer too small");
+  if (reinterpret_cast<uintptr_t>(bytes) % alignof(uint64_t) != 0) throw std::invalid_argument("buffer is not 8-byte aligned");
+  // the keys are selected and sorted in place past the longest preamble
+  uint8_t* ptr = static_cast<uint8_t*>(bytes);
+  uint64_t* keys = reinterpret_cast<uint64_t*>(ptr + compact_theta_sketch_alloc<A>::MAX_PREAMBLE_BYTES);
+  uint64_t theta = std::min(theta_, state_.get_theta64());
+  uint32_t num_keys = 0;
+  for (auto key: state_) {
+    if (key < theta) keys[num_keys++] = key;
+  }
+  const uint32_t nom_num_keys = 1 << state_.lg_nom_size_;
+  if (num_keys > nom_num_keys) {
+    std::nth_element(keys, &keys[nom_num_keys], &keys[num_keys]);
+    theta = keys[nom_num_keys];
+    num_keys = nom_num_keys;
+  }
+  if (ordered) std::sort(keys, &keys[num_keys]);
+  return compact_theta_sketch_alloc<A>::serialize_in_place(ptr, is_empty_, theta, num_keys, state_.get_seed_hash(), ordered);
+}
+
+template<typename A>
+size_t theta_union_alloc<A>::get_max_result_size_bytes() const {
+  return compact_theta_sketch_alloc<A>::MAX_PREAMBLE_BYTES + sizeof(uint64_t) * state_.get_num_retained();
+}
+
+template<typename A>
+void theta_union_alloc<A>::reset() {
+  state_.reset();
+  is_empty_ = true;
+  theta_ = state_.get_theta64();
+}
+
+template<typename A>
+template<typename Iterator>
+compact_theta_sketch_alloc<A> theta_union_alloc<A>::merge_ordered(Iterator first, Iterator last) const {
+  typedef typename std::allocator_traits<A>::template rebind_alloc<uint64_t> AllocU64;
+
+  const uint16_t seed_hash = state_.get_seed_hash();
+  bool is_empty = is_empty_;
+  uint64_t theta = std::min(theta_, state_.get_theta64());
+  uint32_t num_inputs = 1;
+  uint64_t total_num_keys = state_.get_num_retained();
+  for (Iterator it = first; it != last; ++it) {
+    const theta_sketch_alloc<A>& sketch = as_theta_sketch<A>(*it);
+    if (sketch.is_empty()) continue;
+    if (sketch.get_seed_hash() != seed_hash) throw std::invalid_argument("seed hash mismatch");
+    is_empty = false;
+    theta = std::min(theta, sketch.get_theta64());
+    ++num_inputs;
+    total_num_keys += sketch.get_num_retained();
+  }
+
+  theta_sorted_merge_alloc<A> merge(theta, num_inputs);
+  merge.add(state_, 0);
+  for (Iterator it = first; it != last; ++it) merge.add(as_theta_sketch<A>(*it), 0);
+
+  // collect the smallest unique keys below theta, at most the nominal number
+  const uint32_t nom_num_keys = 1 << state_.lg_nom_size_;
+  std::vector<uint64_t, AllocU64> keys;
+  keys.reserve(std::min(static_cast<uint64_t>(nom_num_keys), total_num_keys));
+  while (!merge.is_empty()) {
+    const uint64_t key = merge.get_key();
+    if (keys.empty() or keys.back() != key) {
+      if (keys.size() == nom_num_keys) {
+        theta = key;
+        break;
+      }
+      keys.push_back(key);
+    }
+    merge.next();
+  }
+
+  if (keys.empty()) return compact_theta_sketch_alloc<A>(is_empty, theta, nullptr, 0, seed_hash, true);
+  uint64_t* result_keys = AllocU64().allocate(keys.size());
+  std::copy(keys.begin(), keys.end(), result_keys);
+  return compact_theta_sketch_alloc<A>(false, theta, result_keys, keys.size(), seed_hash, true);
+}
+
 // builder
 
 template<typename A>
@@ -103,6 +208,12 @@ typename theta_union_alloc<A>::builder& theta_union_alloc<A>::builder::set_seed(
   return *this;
 }
 
+template<typename A>
+typename theta_union_alloc<A>::builder& theta_union_alloc<A>::builder::set_table_layout(table_layout layout) {
+  sketch_builder.set_table_layout(layout);
+  return *this;
+}
+
 template<typename A>
 theta_union_alloc<A> theta_union_alloc<A>::builder::build() const {
   update_theta_sketch_alloc<A> sketch = sketch_builder.build();
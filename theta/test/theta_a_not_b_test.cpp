@@ -21,6 +21,7 @@
 #include <cppunit/extensions/HelperMacros.h>
 
 #include <theta_a_not_b.hpp>
+#include <theta_union.hpp>
 
 namespace datasketches {
 
@@ -36,6 +37,8 @@ class theta_a_not_b_test: public CppUnit::TestFixture {
   CPPUNIT_TEST(estimation_mode_disjoint);
   CPPUNIT_TEST(estimation_mode_full_overlap);
   CPPUNIT_TEST(seed_mismatch);
+  CPPUNIT_TEST(multiple_b_exact_mode);
+  CPPUNIT_TEST(multiple_b_estimation_mode);
   CPPUNIT_TEST_SUITE_END();
 
   void empty() {
@@ -232,6 +235,68 @@ class theta_a_not_b_test: public CppUnit::TestFixture {
     CPPUNIT_ASSERT_THROW(a_not_b.compute(sketch, sketch), std::invalid_argument);
   }
 
+  void multiple_b_exact_mode() {
+    update_theta_sketch a = update_theta_sketch::builder().build();
+    for (int i = 0; i < 1000; i++) a.update(i);
+    std::vector<update_theta_sketch> bs;
+    std::vector<compact_theta_sketch> compact_bs;
+    for (int i = 0; i < 5; i++) {
+      bs.push_back(update_theta_sketch::builder().build());
+      for (int j = 0; j < 100; j++) bs.back().update(i * 150 + j); // 500 unique values below 1000
+      compact_bs.push_back(bs.back().compact());
+    }
+    bs.push_back(update_theta_sketch::builder().build()); // empty B is ignored
+
+    theta_a_not_b a_not_b;
+
+    // unordered inputs
+    compact_theta_sketch result = a_not_b.compute(a, bs.begin(), bs.end());
+    CPPUNIT_ASSERT(!result.is_empty());
+    CPPUNIT_ASSERT(!result.is_estimation_mode());
+    CPPUNIT_ASSERT(result.is_ordered());
+    CPPUNIT_ASSERT_EQUAL(500U, result.get_num_retained());
+
+    // ordered inputs
+    result = a_not_b.compute(a.compact(), compact_bs.begin(), compact_bs.end());
+    CPPUNIT_ASSERT(!result.is_empty());
+    CPPUNIT_ASSERT(!result.is_estimation_mode());
+    CPPUNIT_ASSERT_EQUAL(500U, result.get_num_retained());
+
+    // no B at all
+    result = a_not_b.compute(a.compact(), compact_bs.end(), compact_bs.end());
+    CPPUNIT_ASSERT_EQUAL(1000U, result.get_num_retained());
+  }
+
+  void multiple_b_estimation_mode() {
+    update_theta_sketch a = update_theta_sketch::builder().build();
+    for (int i = 0; i < 100000; i++) a.update(i);
+    std::vector<compact_theta_sketch> bs;
+    theta_union u = theta_union::builder().build();
+    for (int i = 0; i < 30; i++) {
+      update_theta_sketch b = update_theta_sketch::builder().build();
+      for (int j = 0; j < 5000; j++) b.update(i * 2000 + j);
+      bs.push_back(b.compact());
+      u.update(b);
+    }
+    compact_theta_sketch b_union = u.get_result();
+
+    theta_a_not_b a_not_b;
+    // reference: A minus the union of all B
+    compact_theta_sketch result1 = a_not_b.compute(a, b_union);
+
+    std::vector<const theta_sketch*> b_ptrs;
+    for (auto& b: bs) b_ptrs.push_back(&b);
+    compact_theta_sketch result2 = a_not_b.compute(a.compact(), b_ptrs.begin(), b_ptrs.end());
+    compact_theta_sketch result3 = a_not_b.compute(a, b_ptrs.begin(), b_ptrs.end(), false);
+    CPPUNIT_ASSERT(result2.is_estimation_mode());
+    CPPUNIT_ASSERT(result2.is_ordered());
+    CPPUNIT_ASSERT(!result3.is_ordered());
+    CPPUNIT_ASSERT_EQUAL(result2.get_num_retained(), result3.get_num_retained());
+    CPPUNIT_ASSERT_EQUAL(result2.get_theta64(), result3.get_theta64());
+    CPPUNIT_ASSERT_DOUBLES_EQUAL(100000 - 63000, result2.get_estimate(), 100000 * 0.05);
+    CPPUNIT_ASSERT_DOUBLES_EQUAL(result1.get_estimate(), result2.get_estimate(), 100000 * 0.05);
+  }
+
 };
 
 CPPUNIT_TEST_SUITE_REGISTRATION(theta_a_not_b_test);
@@ -0,0 +1,134 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+
+#include <cppunit/TestFixture.h>
+#include <cppunit/extensions/HelperMacros.h>
+
+#include <thread>
+#include <vector>
+
+#include <theta_concurrent_sketch.hpp>
+
+namespace datasketches {
+
+class theta_concurrent_sketch_test: public CppUnit::TestFixture {
+
+  CPPUNIT_TEST_SUITE(theta_concurrent_sketch_test);
+  CPPUNIT_TEST(empty);
+  CPPUNIT_TEST(non_empty_no_retained_keys);
+  CPPUNIT_TEST(exact_mode);
+  CPPUNIT_TEST(estimation_mode_multiple_threads);
+  CPPUNIT_TEST(bounded_queue);
+  CPPUNIT_TEST(invalid_buffer_size);
+  CPPUNIT_TEST_SUITE_END();
+
+  void empty() {
+    concurrent_theta_sketch sketch(update_theta_sketch::builder().build());
+    {
+      auto buffer = sketch.get_local_buffer();
+      buffer.update(std::string()); // ignored
+    }
+    sketch.wait_for_propagation();
+    CPPUNIT_ASSERT(sketch.is_empty());
+    CPPUNIT_ASSERT_EQUAL(0.0, sketch.get_estimate());
+    CPPUNIT_ASSERT_EQUAL(1.0, sketch.get_theta());
+    CPPUNIT_ASSERT(sketch.compact().is_empty());
+  }
+
+  void non_empty_no_retained_keys() {
+    concurrent_theta_sketch sketch(update_theta_sketch::builder().set_p(0.001).build(), 16, false);
+    auto buffer = sketch.get_local_buffer();
+    buffer.update(1);
+    CPPUNIT_ASSERT(sketch.is_empty()); // not flushed yet
+    buffer.flush();
+    CPPUNIT_ASSERT(!sketch.is_empty());
+    CPPUNIT_ASSERT_EQUAL(0.0, sketch.get_estimate());
+    compact_theta_sketch result = sketch.compact();
+    CPPUNIT_ASSERT(!result.is_empty());
+    CPPUNIT_ASSERT(result.is_estimation_mode());
+    CPPUNIT_ASSERT_EQUAL(0U, result.get_num_retained());
+  }
+
+  void exact_mode() {
+    concurrent_theta_sketch sketch(update_theta_sketch::builder().build(), 16, false);
+    update_theta_sketch reference = update_theta_sketch::builder().build();
+    auto buffer = sketch.get_local_buffer();
+    for (int i = 0; i < 1000; i++) {
+      buffer.update(i);
+      reference.update(i);
+    }
+    // all full batches are propagated already
+    CPPUNIT_ASSERT_EQUAL(992.0, sketch.get_estimate());
+    buffer.flush();
+    CPPUNIT_ASSERT_EQUAL(1000.0, sketch.get_estimate());
+    compact_theta_sketch result = sketch.compact();
+    compact_theta_sketch expected = reference.compact();
+    CPPUNIT_ASSERT(!result.is_estimation_mode());
+    CPPUNIT_ASSERT(std::equal(expected.begin(), expected.end(), result.begin()));
+  }
+
+  void estimation_mode_multiple_threads() {
+    concurrent_theta_sketch sketch(update_theta_sketch::builder().build());
+    const int num_threads = 8;
+    const int n = 100000;
+    std::vector<std::thread> threads;
+    for (int t = 0; t < num_threads; t++) {
+      threads.push_back(std::thread([&sketch, t] {
+        auto buffer = sketch.get_local_buffer();
+        for (int i = 0; i < n; i++) buffer.update(t * n + i);
+        // half of the values overlap with the next thread
+        for (int i = 0; i < n / 2; i++) buffer.update(((t + 1) % num_threads) * n + i);
+      }));
+    }
+    for (auto& thread: threads) thread.join();
+    sketch.wait_for_propagation();
+    CPPUNIT_ASSERT(!sketch.is_empty());
+    CPPUNIT_ASSERT(sketch.get_theta() < 1);
+    CPPUNIT_ASSERT_DOUBLES_EQUAL(num_threads * n, sketch.get_estimate(), num_threads * n * 0.05);
+    compact_theta_sketch result = sketch.compact();
+    CPPUNIT_ASSERT_EQUAL(sketch.get_estimate(), result.get_estimate());
+  }
+
+  void bounded_queue() {
+    // single-hash batches outrun the propagator, so the writer propagates some of them itself
+    concurrent_theta_sketch sketch(update_theta_sketch::builder().build(), 1);
+    update_theta_sketch reference = update_theta_sketch::builder().build();
+    auto buffer = sketch.get_local_buffer();
+    for (int i = 0; i < 4000; i++) {
+      buffer.update(i);
+      reference.update(i);
+    }
+    sketch.wait_for_propagation();
+    compact_theta_sketch result = sketch.compact();
+    compact_theta_sketch expected = reference.compact();
+    CPPUNIT_ASSERT(!result.is_estimation_mode());
+    CPPUNIT_ASSERT_EQUAL(4000.0, sketch.get_estimate());
+    CPPUNIT_ASSERT(std::equal(expected.begin(), expected.end(), result.begin()));
+  }
+
+  void invalid_buffer_size() {
+    CPPUNIT_ASSERT_THROW(concurrent_theta_sketch(update_theta_sketch::builder().build(), 0), std::invalid_argument);
+  }
+
+};
+
+CPPUNIT_TEST_SUITE_REGISTRATION(theta_concurrent_sketch_test);
+
+} /* namespace datasketches */
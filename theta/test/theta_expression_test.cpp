@@ -0,0 +1,161 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+
+#include <cppunit/TestFixture.h>
+#include <cppunit/extensions/HelperMacros.h>
+
+#include <theta_expression.hpp>
+#include <theta_union.hpp>
+#include <theta_intersection.hpp>
+#include <theta_a_not_b.hpp>
+
+namespace datasketches {
+
+class theta_expression_test: public CppUnit::TestFixture {
+
+  CPPUNIT_TEST_SUITE(theta_expression_test);
+  CPPUNIT_TEST(empty);
+  CPPUNIT_TEST(exact_mode);
+  CPPUNIT_TEST(estimation_mode);
+  CPPUNIT_TEST(exact_union);
+  CPPUNIT_TEST(invalid_node);
+  CPPUNIT_TEST(seed_mismatch);
+  CPPUNIT_TEST_SUITE_END();
+
+  void empty() {
+    update_theta_sketch a = update_theta_sketch::builder().build();
+    update_theta_sketch b = update_theta_sketch::builder().build();
+    b.update(1);
+    theta_expression expr;
+    const auto id_a = expr.add_sketch(a);
+    const auto id_b = expr.add_sketch(b);
+
+    compact_theta_sketch result = expr.compute(expr.add_intersection({id_a, id_b}));
+    CPPUNIT_ASSERT(result.is_empty());
+    CPPUNIT_ASSERT_EQUAL(0U, result.get_num_retained());
+
+    result = expr.compute(expr.add_a_not_b(id_a, id_b));
+    CPPUNIT_ASSERT(result.is_empty());
+
+    result = expr.compute(expr.add_union({id_a, id_b}));
+    CPPUNIT_ASSERT(!result.is_empty());
+    CPPUNIT_ASSERT_EQUAL(1U, result.get_num_retained());
+  }
+
+  void exact_mode() {
+    update_theta_sketch a = update_theta_sketch::builder().build();
+    update_theta_sketch b = update_theta_sketch::builder().build();
+    update_theta_sketch c = update_theta_sketch::builder().build();
+    update_theta_sketch d = update_theta_sketch::builder().build();
+    for (int i = 0; i < 1000; i++) a.update(i);
+    for (int i = 500; i < 1500; i++) b.update(i);
+    for (int i = 250; i < 1250; i++) c.update(i);
+    for (int i = 1000; i < 2000; i++) d.update(i);
+    compact_theta_sketch compact_c = c.compact();
+
+    // (A union B) intersection (C minus D) = [250, 1000)
+    theta_expression expr;
+    const auto id_a = expr.add_sketch(a);
+    const auto id_b = expr.add_sketch(b);
+    const auto id_c = expr.add_sketch(compact_c);
+    const auto id_d = expr.add_sketch(d);
+    const auto root = expr.add_intersection({expr.add_union({id_a, id_b}), expr.add_a_not_b(id_c, id_d)});
+    compact_theta_sketch result = expr.compute(root);
+    CPPUNIT_ASSERT(!result.is_empty());
+    CPPUNIT_ASSERT(!result.is_estimation_mode());
+    CPPUNIT_ASSERT(result.is_ordered());
+    CPPUNIT_ASSERT_EQUAL(750.0, result.get_estimate());
+  }
+
+  void estimation_mode() {
+    update_theta_sketch a = update_theta_sketch::builder().build();
+    update_theta_sketch b = update_theta_sketch::builder().build();
+    update_theta_sketch c = update_theta_sketch::builder().build();
+    update_theta_sketch d = update_theta_sketch::builder().build();
+    for (int i = 0; i < 100000; i++) a.update(i);
+    for (int i = 50000; i < 150000; i++) b.update(i);
+    for (int i = 25000; i < 125000; i++) c.update(i);
+    for (int i = 100000; i < 200000; i++) d.update(i);
+
+    // reference: the same expression using intermediate sketches
+    theta_union u = theta_union::builder().build();
+    u.update(a);
+    u.update(b);
+    theta_a_not_b a_not_b;
+    theta_intersection intersection;
+    intersection.update(u.get_result());
+    intersection.update(a_not_b.compute(c, d));
+    compact_theta_sketch reference = intersection.get_result();
+
+    theta_expression expr;
+    const auto id_a = expr.add_sketch(a);
+    const auto id_b = expr.add_sketch(b);
+    const auto id_c = expr.add_sketch(c);
+    const auto id_d = expr.add_sketch(d);
+    const auto root = expr.add_intersection({expr.add_union({id_a, id_b}), expr.add_a_not_b(id_c, id_d)});
+    compact_theta_sketch result = expr.compute(root);
+    CPPUNIT_ASSERT(result.is_estimation_mode());
+    CPPUNIT_ASSERT_DOUBLES_EQUAL(75000, result.get_estimate(), 75000 * 0.05);
+    CPPUNIT_ASSERT_DOUBLES_EQUAL(reference.get_estimate(), result.get_estimate(), 75000 * 0.05);
+  }
+
+  void exact_union() {
+    update_theta_sketch a = update_theta_sketch::builder().set_lg_k(10).build();
+    update_theta_sketch b = update_theta_sketch::builder().set_lg_k(10).build();
+    for (int i = 0; i < 1000; i++) a.update(i);
+    for (int i = 1000; i < 2000; i++) b.update(i);
+
+    theta_expression expr;
+    const auto root = expr.add_union({expr.add_sketch(a), expr.add_sketch(b)});
+    compact_theta_sketch result = expr.compute(root);
+    // not capped at the nominal size, unlike theta_union
+    CPPUNIT_ASSERT(!result.is_estimation_mode());
+    CPPUNIT_ASSERT(result.is_ordered());
+    CPPUNIT_ASSERT_EQUAL(2000U, result.get_num_retained());
+
+    theta_union u = theta_union::builder().set_lg_k(10).build();
+    u.update(a);
+    u.update(b);
+    compact_theta_sketch reference = u.get_result();
+    CPPUNIT_ASSERT(reference.is_estimation_mode());
+    CPPUNIT_ASSERT_DOUBLES_EQUAL(result.get_estimate(), reference.get_estimate(), 2000 * 0.1);
+  }
+
+  void invalid_node() {
+    update_theta_sketch a = update_theta_sketch::builder().build();
+    theta_expression expr;
+    const auto id_a = expr.add_sketch(a);
+    CPPUNIT_ASSERT_THROW(expr.add_union({id_a, 1}), std::invalid_argument);
+    CPPUNIT_ASSERT_THROW(expr.add_intersection({}), std::invalid_argument);
+    CPPUNIT_ASSERT_THROW(expr.compute(1), std::invalid_argument);
+  }
+
+  void seed_mismatch() {
+    update_theta_sketch sketch = update_theta_sketch::builder().build();
+    sketch.update(1); // non-empty should not be ignored
+    theta_expression expr(123);
+    CPPUNIT_ASSERT_THROW(expr.add_sketch(sketch), std::invalid_argument);
+  }
+
+};
+
+CPPUNIT_TEST_SUITE_REGISTRATION(theta_expression_test);
+
+} /* namespace datasketches */
@@ -20,6 +20,8 @@
 #include <cppunit/TestFixture.h>
 #include <cppunit/extensions/HelperMacros.h>
 
+#include <vector>
+
 #include <theta_intersection.hpp>
 
 namespace datasketches {
@@ -39,6 +41,12 @@ class theta_intersection_test: public CppUnit::TestFixture {
   CPPUNIT_TEST(estimation_mode_disjoint_unordered);
   CPPUNIT_TEST(estimation_mode_disjoint_ordered);
   CPPUNIT_TEST(seed_mismatch);
+  CPPUNIT_TEST(ordered_large_and_small);
+  CPPUNIT_TEST(ordered_then_unordered);
+  CPPUNIT_TEST(reset);
+  CPPUNIT_TEST(get_result_into_buffer);
+  CPPUNIT_TEST(summary);
+  CPPUNIT_TEST(summary_of_two);
   CPPUNIT_TEST_SUITE_END();
 
   void invalid() {
@@ -233,6 +241,186 @@ class theta_intersection_test: public CppUnit::TestFixture {
     CPPUNIT_ASSERT_THROW(intersection.update(sketch), std::invalid_argument);
   }
 
+  void ordered_large_and_small() {
+    update_theta_sketch sketch1 = update_theta_sketch::builder().set_lg_k(16).build();
+    for (int i = 0; i < 100000; i++) sketch1.update(i);
+    update_theta_sketch sketch2 = update_theta_sketch::builder().set_lg_k(16).build();
+    for (int i = 0; i < 1000; i++) sketch2.update(i * 3);
+    update_theta_sketch sketch3 = update_theta_sketch::builder().set_lg_k(16).build();
+    for (int i = 0; i < 1000; i++) sketch3.update(i * 2);
+
+    // reference result from the hash-based path
+    theta_intersection intersection1;
+    intersection1.update(sketch1);
+    intersection1.update(sketch2);
+    intersection1.update(sketch3);
+    compact_theta_sketch result1 = intersection1.get_result();
+    CPPUNIT_ASSERT_EQUAL(334U, result1.get_num_retained());
+
+    // large first, then small: galloping search in the retained keys
+    theta_intersection intersection2;
+    intersection2.update(sketch1.compact());
+    intersection2.update(sketch2.compact());
+    intersection2.update(sketch3.compact());
+    compact_theta_sketch result2 = intersection2.get_result(false);
+    CPPUNIT_ASSERT(result2.is_ordered());
+
+    // small first, then large: galloping search in the incoming sketch
+    theta_intersection intersection3;
+    intersection3.update(sketch2.compact());
+    intersection3.update(sketch1.compact());
+    intersection3.update(sketch3.compact());
+    compact_theta_sketch result3 = intersection3.get_result();
+
+    CPPUNIT_ASSERT_EQUAL(result1.get_num_retained(), result2.get_num_retained());
+    CPPUNIT_ASSERT_EQUAL(result1.get_num_retained(), result3.get_num_retained());
+    CPPUNIT_ASSERT_EQUAL(result1.get_theta64(), result2.get_theta64());
+    CPPUNIT_ASSERT_EQUAL(result1.get_theta64(), result3.get_theta64());
+    auto iter2 = result2.begin();
+    auto iter3 = result3.begin();
+    for (auto key: result1) {
+      CPPUNIT_ASSERT_EQUAL(key, *iter2);
+      CPPUNIT_ASSERT_EQUAL(key, *iter3);
+      ++iter2;
+      ++iter3;
+    }
+
+    // copies must keep the sorted state
+    theta_intersection intersection4(intersection2);
+    CPPUNIT_ASSERT_EQUAL(result1.get_num_retained(), intersection4.get_result().get_num_retained());
+  }
+
+  void ordered_then_unordered() {
+    update_theta_sketch sketch1 = update_theta_sketch::builder().build();
+    int value = 0;
+    for (int i = 0; i < 10000; i++) sketch1.update(value++);
+
+    update_theta_sketch sketch2 = update_theta_sketch::builder().build();
+    value = 5000;
+    for (int i = 0; i < 10000; i++) sketch2.update(value++);
+
+    update_theta_sketch sketch3 = update_theta_sketch::builder().build();
+    value = 7500;
+    for (int i = 0; i < 10000; i++) sketch3.update(value++);
+
+    theta_intersection intersection;
+    intersection.update(sketch1.compact());
+    intersection.update(sketch2.compact());
+    intersection.update(sketch3);
+    compact_theta_sketch result = intersection.get_result();
+    CPPUNIT_ASSERT(!result.is_empty());
+    CPPUNIT_ASSERT(result.is_estimation_mode());
+    CPPUNIT_ASSERT_DOUBLES_EQUAL(2500, result.get_estimate(), 2500 * 0.05);
+  }
+
+  void reset() {
+    update_theta_sketch sketch1 = update_theta_sketch::builder().build();
+    for (int i = 0; i < 10000; i++) sketch1.update(i);
+    update_theta_sketch sketch2 = update_theta_sketch::builder().build();
+    for (int i = 5000; i < 15000; i++) sketch2.update(i);
+    update_theta_sketch sketch3 = update_theta_sketch::builder().build();
+    for (int i = 20000; i < 30000; i++) sketch3.update(i);
+
+    theta_intersection intersection;
+    intersection.update(sketch1);
+    intersection.update(sketch3); // no matches
+    intersection.reset();
+    CPPUNIT_ASSERT(!intersection.has_result());
+
+    // unordered, then ordered inputs after reset
+    for (bool ordered: {false, true}) {
+      intersection.update(sketch1.compact(ordered));
+      intersection.update(sketch2.compact(ordered));
+      theta_intersection fresh_intersection;
+      fresh_intersection.update(sketch1.compact(ordered));
+      fresh_intersection.update(sketch2.compact(ordered));
+      CPPUNIT_ASSERT(fresh_intersection.get_result().serialize() == intersection.get_result().serialize());
+      intersection.reset();
+    }
+  }
+
+  void get_result_into_buffer() {
+    theta_intersection intersection;
+    std::vector<uint64_t> buffer(4);
+    CPPUNIT_ASSERT_THROW(intersection.get_result(buffer.data(), buffer.size() * sizeof(uint64_t)), std::invalid_argument);
+
+    update_theta_sketch sketch1 = update_theta_sketch::builder().build();
+    for (int i = 0; i < 10000; i++) sketch1.update(i);
+    update_theta_sketch sketch2 = update_theta_sketch::builder().build();
+    for (int i = 5000; i < 15000; i++) sketch2.update(i);
+    intersection.update(sketch1);
+    intersection.update(sketch2);
+
+    buffer.resize(intersection.get_max_result_size_bytes() / sizeof(uint64_t));
+    size_t size = intersection.get_result(buffer.data(), buffer.size() * sizeof(uint64_t));
+    auto bytes = intersection.get_result().serialize();
+    CPPUNIT_ASSERT_EQUAL(bytes.size(), size);
+    CPPUNIT_ASSERT(std::equal(bytes.begin(), bytes.end(), reinterpret_cast<const uint8_t*>(buffer.data())));
+    auto wrapped = wrapped_compact_theta_sketch::wrap(buffer.data(), size);
+    CPPUNIT_ASSERT_DOUBLES_EQUAL(5000, wrapped.get_estimate(), 5000 * 0.05);
+  }
+
+  void summary() {
+    theta_intersection intersection;
+    CPPUNIT_ASSERT_THROW(intersection.get_summary(), std::invalid_argument);
+    update_theta_sketch sketch1 = update_theta_sketch::builder().build();
+    for (int i = 0; i < 10000; i++) sketch1.update(i);
+    update_theta_sketch sketch2 = update_theta_sketch::builder().build();
+    for (int i = 5000; i < 15000; i++) sketch2.update(i);
+    intersection.update(sketch1);
+    intersection.update(sketch2);
+    const compact_theta_sketch result = intersection.get_result();
+    const theta_intersection::summary summary = intersection.get_summary();
+    CPPUNIT_ASSERT_EQUAL(result.is_empty(), summary.is_empty);
+    CPPUNIT_ASSERT_EQUAL(result.get_num_retained(), summary.num_keys);
+    CPPUNIT_ASSERT_EQUAL(result.get_theta64(), summary.theta);
+    CPPUNIT_ASSERT(summary.is_estimation_mode());
+    CPPUNIT_ASSERT_EQUAL(result.get_estimate(), summary.get_estimate());
+    CPPUNIT_ASSERT_EQUAL(result.get_lower_bound(2), summary.get_lower_bound(2));
+    CPPUNIT_ASSERT_EQUAL(result.get_upper_bound(2), summary.get_upper_bound(2));
+  }
+
+  void summary_of_two() {
+    std::vector<update_theta_sketch> sketches;
+    sketches.push_back(update_theta_sketch::builder().build()); // empty
+    sketches.push_back(update_theta_sketch::builder().build());
+    for (int i = 0; i < 1000; i++) sketches.back().update(i); // exact
+    sketches.push_back(update_theta_sketch::builder().build());
+    for (int i = 500; i < 1500; i++) sketches.back().update(i); // exact
+    sketches.push_back(update_theta_sketch::builder().build());
+    for (int i = 2000; i < 3000; i++) sketches.back().update(i); // exact, disjoint
+    sketches.push_back(update_theta_sketch::builder().build());
+    for (int i = 0; i < 10000; i++) sketches.back().update(i); // estimation
+    sketches.push_back(update_theta_sketch::builder().set_lg_k(10).build());
+    for (int i = 5000; i < 15000; i++) sketches.back().update(i); // estimation
+    sketches.push_back(update_theta_sketch::builder().set_p(0.001).build());
+    sketches.back().update(1); // no retained keys
+
+    for (const auto& a: sketches) {
+      for (const auto& b: sketches) {
+        theta_intersection intersection;
+        intersection.update(a);
+        intersection.update(b);
+        const compact_theta_sketch expected = intersection.get_result();
+        // all combinations of update, unordered and ordered compact sketches
+        for (int i = 0; i < 9; i++) {
+          const compact_theta_sketch compact_a = a.compact(i % 3 == 1);
+          const compact_theta_sketch compact_b = b.compact(i / 3 == 1);
+          const theta_sketch& sketch_a = i % 3 == 0 ? static_cast<const theta_sketch&>(a) : compact_a;
+          const theta_sketch& sketch_b = i / 3 == 0 ? static_cast<const theta_sketch&>(b) : compact_b;
+          const theta_intersection::summary summary = theta_intersection::get_summary(sketch_a, sketch_b);
+          CPPUNIT_ASSERT_EQUAL(expected.is_empty(), summary.is_empty);
+          CPPUNIT_ASSERT_EQUAL(expected.get_num_retained(), summary.num_keys);
+          CPPUNIT_ASSERT_EQUAL(expected.get_theta64(), summary.theta);
+          CPPUNIT_ASSERT_EQUAL(expected.get_estimate(), summary.get_estimate());
+        }
+      }
+    }
+
+    update_theta_sketch sketch = update_theta_sketch::builder().set_seed(123).build();
+    CPPUNIT_ASSERT_THROW(theta_intersection::get_summary(sketches[1], sketch), std::invalid_argument);
+  }
+
 };
 
 CPPUNIT_TEST_SUITE_REGISTRATION(theta_intersection_test);
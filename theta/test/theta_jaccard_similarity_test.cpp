@@ -0,0 +1,137 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+
+#include <cppunit/TestFixture.h>
+#include <cppunit/extensions/HelperMacros.h>
+
+#include <vector>
+
+#include <theta_jaccard_similarity.hpp>
+
+namespace datasketches {
+
+class theta_jaccard_similarity_test: public CppUnit::TestFixture {
+
+  CPPUNIT_TEST_SUITE(theta_jaccard_similarity_test);
+  CPPUNIT_TEST(empty);
+  CPPUNIT_TEST(same_sketch);
+  CPPUNIT_TEST(exact_mode);
+  CPPUNIT_TEST(estimation_mode);
+  CPPUNIT_TEST(matrix);
+  CPPUNIT_TEST(seed_mismatch);
+  CPPUNIT_TEST_SUITE_END();
+
+  void empty() {
+    update_theta_sketch a = update_theta_sketch::builder().build();
+    update_theta_sketch b = update_theta_sketch::builder().build();
+    auto s = theta_jaccard_similarity::jaccard(a, b);
+    CPPUNIT_ASSERT_EQUAL(1.0, s.lower_bound);
+    CPPUNIT_ASSERT_EQUAL(1.0, s.estimate);
+    CPPUNIT_ASSERT_EQUAL(1.0, s.upper_bound);
+
+    b.update(1);
+    s = theta_jaccard_similarity::jaccard(a, b);
+    CPPUNIT_ASSERT_EQUAL(0.0, s.lower_bound);
+    CPPUNIT_ASSERT_EQUAL(0.0, s.estimate);
+    CPPUNIT_ASSERT_EQUAL(0.0, s.upper_bound);
+  }
+
+  void same_sketch() {
+    update_theta_sketch a = update_theta_sketch::builder().build();
+    for (int i = 0; i < 1000; i++) a.update(i);
+    auto s = theta_jaccard_similarity::jaccard(a, a);
+    CPPUNIT_ASSERT_EQUAL(1.0, s.lower_bound);
+    CPPUNIT_ASSERT_EQUAL(1.0, s.estimate);
+    CPPUNIT_ASSERT_EQUAL(1.0, s.upper_bound);
+    CPPUNIT_ASSERT_EQUAL(1000.0, s.intersection_estimate);
+
+    // equal sets in different sketches, lower bound is not certain
+    compact_theta_sketch b = a.compact();
+    s = theta_jaccard_similarity::jaccard(a, b);
+    CPPUNIT_ASSERT(s.lower_bound < 1);
+    CPPUNIT_ASSERT(s.lower_bound > 0.99);
+    CPPUNIT_ASSERT_EQUAL(1.0, s.estimate);
+    CPPUNIT_ASSERT_EQUAL(1.0, s.upper_bound);
+  }
+
+  void exact_mode() {
+    update_theta_sketch a = update_theta_sketch::builder().build();
+    for (int i = 0; i < 1000; i++) a.update(i);
+    update_theta_sketch b = update_theta_sketch::builder().build();
+    for (int i = 500; i < 1500; i++) b.update(i);
+    auto s = theta_jaccard_similarity::jaccard(a, b);
+    CPPUNIT_ASSERT_DOUBLES_EQUAL(1.0 / 3, s.estimate, 1e-10);
+    CPPUNIT_ASSERT(s.lower_bound < s.estimate);
+    CPPUNIT_ASSERT(s.upper_bound > s.estimate);
+    CPPUNIT_ASSERT_EQUAL(500.0, s.intersection_estimate);
+  }
+
+  void estimation_mode() {
+    update_theta_sketch a = update_theta_sketch::builder().build();
+    for (int i = 0; i < 100000; i++) a.update(i);
+    update_theta_sketch b = update_theta_sketch::builder().build();
+    for (int i = 50000; i < 150000; i++) b.update(i);
+    auto s = theta_jaccard_similarity::jaccard(a, b.compact(false));
+    CPPUNIT_ASSERT_DOUBLES_EQUAL(1.0 / 3, s.estimate, 0.03);
+    CPPUNIT_ASSERT(s.lower_bound < 1.0 / 3);
+    CPPUNIT_ASSERT(s.upper_bound > 1.0 / 3);
+    CPPUNIT_ASSERT_DOUBLES_EQUAL(50000, s.intersection_estimate, 50000 * 0.1);
+  }
+
+  void matrix() {
+    std::vector<compact_theta_sketch> sketches;
+    const int n = 70; // more than one tile
+    for (int i = 0; i < n; i++) {
+      update_theta_sketch sketch = update_theta_sketch::builder().set_lg_k(10).build();
+      for (int j = 0; j < 1000 * (i % 7 + 1); j++) sketch.update(i * 500 + j);
+      sketches.push_back(sketch.compact(i % 2 == 0));
+    }
+    auto result1 = theta_jaccard_similarity::jaccard_matrix(sketches.begin(), sketches.end());
+    auto result2 = theta_jaccard_similarity::jaccard_matrix(sketches.begin(), sketches.end(), 4);
+    CPPUNIT_ASSERT_EQUAL(static_cast<size_t>(n * n), result1.size());
+    for (int i = 0; i < n; i++) {
+      CPPUNIT_ASSERT_EQUAL(1.0, result1[i * n + i].estimate);
+      for (int j = 0; j < n; j++) {
+        CPPUNIT_ASSERT_EQUAL(result1[i * n + j].estimate, result2[i * n + j].estimate);
+        CPPUNIT_ASSERT_EQUAL(result1[i * n + j].lower_bound, result2[i * n + j].lower_bound);
+        CPPUNIT_ASSERT_EQUAL(result1[i * n + j].estimate, result1[j * n + i].estimate);
+        if (i != j) {
+          auto s = theta_jaccard_similarity::jaccard(sketches[i], sketches[j]);
+          CPPUNIT_ASSERT_EQUAL(s.estimate, result1[i * n + j].estimate);
+          CPPUNIT_ASSERT_EQUAL(s.upper_bound, result1[i * n + j].upper_bound);
+          CPPUNIT_ASSERT_EQUAL(s.intersection_estimate, result1[i * n + j].intersection_estimate);
+        }
+      }
+    }
+  }
+
+  void seed_mismatch() {
+    update_theta_sketch a = update_theta_sketch::builder().build();
+    a.update(1);
+    update_theta_sketch b = update_theta_sketch::builder().set_seed(123).build();
+    b.update(1);
+    CPPUNIT_ASSERT_THROW(theta_jaccard_similarity::jaccard(a, b), std::invalid_argument);
+  }
+
+};
+
+CPPUNIT_TEST_SUITE_REGISTRATION(theta_jaccard_similarity_test);
+
+} /* namespace datasketches */
@@ -20,6 +20,9 @@
 #include <cppunit/TestFixture.h>
 #include <cppunit/extensions/HelperMacros.h>
 
+#include <algorithm>
+#include <random>
+
 #include <theta_sketch.hpp>
 
 namespace datasketches {
@@ -36,6 +39,7 @@ class theta_sketch_test: public CppUnit::TestFixture {
   CPPUNIT_TEST(single_item);
   CPPUNIT_TEST(resize_exact);
   CPPUNIT_TEST(estimation);
+  CPPUNIT_TEST(rebuild_duplicates);
   CPPUNIT_TEST(deserialize_update_empty_from_java_as_base);
   CPPUNIT_TEST(deserialize_update_empty_from_java_as_subclass);
   CPPUNIT_TEST(deserialize_update_estimation_from_java_as_base);
@@ -47,6 +51,17 @@ class theta_sketch_test: public CppUnit::TestFixture {
   CPPUNIT_TEST(deserialize_compact_estimation_from_java_as_base);
   CPPUNIT_TEST(deserialize_compact_estimation_from_java_as_subclass);
   CPPUNIT_TEST(serialize_deserialize_stream_and_bytes_equivalency);
+  CPPUNIT_TEST(batch_update);
+  CPPUNIT_TEST(update_hashed);
+  CPPUNIT_TEST(wrap_compact_empty);
+  CPPUNIT_TEST(wrap_compact_estimation_from_java);
+  CPPUNIT_TEST(wrap_compact_exact);
+  CPPUNIT_TEST(serialize_deserialize_compressed);
+  CPPUNIT_TEST(serialize_compressed_fallback);
+  CPPUNIT_TEST(reset);
+  CPPUNIT_TEST(bucketized_table_layout);
+  CPPUNIT_TEST(from_hashes);
+  CPPUNIT_TEST(adopt_serialized_buffer);
   CPPUNIT_TEST_SUITE_END();
 
   void empty() {
@@ -152,6 +167,30 @@ class theta_sketch_test: public CppUnit::TestFixture {
     CPPUNIT_ASSERT(compact_sketch.get_upper_bound(1) > n);
 }
 
+  void rebuild_duplicates() {
+    update_theta_sketch update_sketch = update_theta_sketch::builder().set_lg_k(10).build();
+    const int n = 100000;
+    for (int i = 0; i < n; i++) update_sketch.update(i);
+    const uint32_t num_retained = update_sketch.get_num_retained();
+    const uint64_t theta = update_sketch.get_theta64();
+    uint32_t count = 0;
+    for (auto key: update_sketch) {
+      CPPUNIT_ASSERT(key < theta);
+      ++count;
+    }
+    CPPUNIT_ASSERT_EQUAL(num_retained, count);
+
+    // all retained keys must still be found after rebuilds, so repeated values must not be inserted again
+    for (int i = 0; i < n; i++) update_sketch.update(i);
+    CPPUNIT_ASSERT_EQUAL(num_retained, update_sketch.get_num_retained());
+    CPPUNIT_ASSERT_EQUAL(theta, update_sketch.get_theta64());
+
+    update_sketch.trim();
+    CPPUNIT_ASSERT_EQUAL(1U << 10, update_sketch.get_num_retained());
+    for (int i = 0; i < n; i++) update_sketch.update(i);
+    CPPUNIT_ASSERT_EQUAL(1U << 10, update_sketch.get_num_retained());
+  }
+
   void deserialize_update_empty_from_java_as_base() {
     std::ifstream is;
     is.exceptions(std::ios::failbit | std::ios::badbit);
@@ -437,6 +476,320 @@ class theta_sketch_test: public CppUnit::TestFixture {
     }
   }
 
+  void update_hashed() {
+    update_theta_sketch sketch1 = update_theta_sketch::builder().set_seed(123).build();
+    update_theta_sketch sketch2 = update_theta_sketch::builder().set_seed(123).build();
+    for (uint64_t i = 0; i < 10000; i++) {
+      sketch1.update(i);
+      HashState hashes;
+      MurmurHash3_x64_128(&i, sizeof(i), 123, hashes);
+      sketch2.update_hashed(hashes.h1, hashes.h2, 123);
+    }
+    CPPUNIT_ASSERT_EQUAL(sketch1.get_theta64(), sketch2.get_theta64());
+    compact_theta_sketch compact1 = sketch1.compact();
+    compact_theta_sketch compact2 = sketch2.compact();
+    CPPUNIT_ASSERT_EQUAL(compact1.get_num_retained(), compact2.get_num_retained());
+    CPPUNIT_ASSERT(std::equal(compact1.begin(), compact1.end(), compact2.begin()));
+    CPPUNIT_ASSERT_THROW(sketch2.update_hashed(1, 1), std::invalid_argument);
+  }
+
+  void batch_update() {
+    const int n = 20000;
+    std::vector<uint64_t> values(n);
+    for (int i = 0; i < n; i++) values[i] = i;
+    std::vector<std::string> strings(n);
+    for (int i = 0; i < n; i++) strings[i] = std::to_string(i);
+    strings[n / 2] = ""; // must be ignored
+    std::string data;
+    std::vector<uint32_t> offsets(1, 0);
+    for (auto& str: strings) {
+      data.append(str);
+      offsets.push_back(data.size());
+    }
+
+    update_theta_sketch sketch1 = update_theta_sketch::builder().build();
+    update_theta_sketch sketch2 = update_theta_sketch::builder().build();
+    for (auto value: values) sketch1.update(value);
+    sketch2.update_batch(values.data(), n);
+    // same sequence of insertions, so the hash tables must be identical
+    CPPUNIT_ASSERT(sketch2.is_estimation_mode());
+    CPPUNIT_ASSERT_EQUAL(sketch1.get_num_retained(), sketch2.get_num_retained());
+    CPPUNIT_ASSERT_EQUAL(sketch1.get_theta64(), sketch2.get_theta64());
+    auto iter = sketch1.begin();
+    for (auto key: sketch2) {
+      CPPUNIT_ASSERT_EQUAL(*iter, key);
+      ++iter;
+    }
+
+    update_theta_sketch sketch3 = update_theta_sketch::builder().build();
+    update_theta_sketch sketch4 = update_theta_sketch::builder().build();
+    update_theta_sketch sketch5 = update_theta_sketch::builder().build();
+    for (auto& str: strings) sketch3.update(str);
+    sketch4.update_batch(strings.data(), n);
+    sketch5.update_batch(data.data(), offsets.data(), n);
+    CPPUNIT_ASSERT_EQUAL(sketch3.get_num_retained(), sketch4.get_num_retained());
+    CPPUNIT_ASSERT_EQUAL(sketch3.get_num_retained(), sketch5.get_num_retained());
+    CPPUNIT_ASSERT_EQUAL(sketch3.get_theta64(), sketch4.get_theta64());
+    CPPUNIT_ASSERT_EQUAL(sketch3.get_theta64(), sketch5.get_theta64());
+    iter = sketch3.begin();
+    auto iter5 = sketch5.begin();
+    for (auto key: sketch4) {
+      CPPUNIT_ASSERT_EQUAL(*iter, key);
+      CPPUNIT_ASSERT_EQUAL(*iter5, key);
+      ++iter;
+      ++iter5;
+    }
+
+    update_theta_sketch sketch6 = update_theta_sketch::builder().build();
+    sketch6.update_batch(values.data(), 0);
+    CPPUNIT_ASSERT(sketch6.is_empty());
+  }
+
+  void wrap_compact_empty() {
+    update_theta_sketch update_sketch = update_theta_sketch::builder().build();
+    auto bytes = update_sketch.compact().serialize();
+    auto sketch = wrapped_compact_theta_sketch::wrap(bytes.data(), bytes.size());
+    CPPUNIT_ASSERT(sketch.is_empty());
+    CPPUNIT_ASSERT(!sketch.is_estimation_mode());
+    CPPUNIT_ASSERT_EQUAL(0U, sketch.get_num_retained());
+    CPPUNIT_ASSERT(sketch.begin() == sketch.end());
+    CPPUNIT_ASSERT_EQUAL(0.0, sketch.get_estimate());
+  }
+
+  void wrap_compact_estimation_from_java() {
+    std::ifstream is;
+    is.exceptions(std::ios::failbit | std::ios::badbit);
+    is.open(inputPath + "theta_compact_estimation_from_java.bin", std::ios::binary | std::ios::ate);
+    std::vector<uint8_t> bytes(is.tellg());
+    is.seekg(0, std::ios::beg);
+    is.read((char*)bytes.data(), bytes.size());
+    auto sketch = wrapped_compact_theta_sketch::wrap(bytes.data(), bytes.size());
+    CPPUNIT_ASSERT(!sketch.is_empty());
+    CPPUNIT_ASSERT(sketch.is_estimation_mode());
+    CPPUNIT_ASSERT(sketch.is_ordered());
+    CPPUNIT_ASSERT_EQUAL(4342U, sketch.get_num_retained());
+    CPPUNIT_ASSERT_DOUBLES_EQUAL(0.531700444213199, sketch.get_theta(), 1e-10);
+    CPPUNIT_ASSERT_DOUBLES_EQUAL(8166.25234614053, sketch.get_estimate(), 1e-10);
+    CPPUNIT_ASSERT_DOUBLES_EQUAL(7996.956955317471, sketch.get_lower_bound(2), 1e-10);
+    CPPUNIT_ASSERT_DOUBLES_EQUAL(8339.090301078124, sketch.get_upper_bound(2), 1e-10);
+
+    // must iterate the same keys as the deserialized copy
+    auto deserialized_sketch = compact_theta_sketch::deserialize(bytes.data(), bytes.size());
+    auto iter = sketch.begin();
+    for (auto key: deserialized_sketch) {
+      CPPUNIT_ASSERT_EQUAL(key, *iter);
+      ++iter;
+    }
+    CPPUNIT_ASSERT(iter == sketch.end());
+
+    // serializing the view must reproduce the original image
+    auto bytes2 = sketch.serialize();
+    CPPUNIT_ASSERT(std::equal(bytes.begin(), bytes.end(), bytes2.begin()));
+
+    CPPUNIT_ASSERT_THROW(wrapped_compact_theta_sketch::wrap(bytes.data(), bytes.size() - 1), std::invalid_argument);
+    CPPUNIT_ASSERT_THROW(wrapped_compact_theta_sketch::wrap(bytes.data(), bytes.size(), 123), std::invalid_argument);
+  }
+
+  void wrap_compact_exact() {
+    update_theta_sketch update_sketch = update_theta_sketch::builder().build();
+    for (int i = 0; i < 100; i++) update_sketch.update(i);
+    auto bytes = update_sketch.compact(false).serialize();
+    auto sketch = wrapped_compact_theta_sketch::wrap(bytes.data(), bytes.size());
+    CPPUNIT_ASSERT(!sketch.is_empty());
+    CPPUNIT_ASSERT(!sketch.is_estimation_mode());
+    CPPUNIT_ASSERT(!sketch.is_ordered());
+    CPPUNIT_ASSERT_EQUAL(100U, sketch.get_num_retained());
+    CPPUNIT_ASSERT_EQUAL(100.0, sketch.get_estimate());
+
+    // the buffer can be larger than the sketch image
+    bytes.resize(bytes.size() + 8);
+    auto sketch2 = wrapped_compact_theta_sketch::wrap(bytes.data(), bytes.size());
+    CPPUNIT_ASSERT_EQUAL(bytes.size() - 8, sketch2.serialize().size());
+
+    // update sketches cannot be wrapped
+    auto update_bytes = update_sketch.serialize();
+    CPPUNIT_ASSERT_THROW(wrapped_compact_theta_sketch::wrap(update_bytes.data(), update_bytes.size()), std::invalid_argument);
+  }
+
+  void serialize_deserialize_compressed() {
+    update_theta_sketch update_sketch = update_theta_sketch::builder().build();
+    for (int n: {2, 10, 1000, 100000}) {
+      for (int i = 0; i < n; i++) update_sketch.update(i);
+      compact_theta_sketch compact_sketch = update_sketch.compact();
+      auto bytes = compact_sketch.serialize_compressed();
+      CPPUNIT_ASSERT_EQUAL(compact_theta_sketch::COMPRESSED_SERIAL_VERSION, bytes[1]);
+      CPPUNIT_ASSERT(bytes.size() < compact_sketch.serialize().size());
+
+      std::stringstream s(std::ios::in | std::ios::out | std::ios::binary);
+      compact_sketch.serialize_compressed(s);
+      CPPUNIT_ASSERT_EQUAL(static_cast<std::streampos>(bytes.size()), s.tellp());
+
+      compact_theta_sketch sketch1 = compact_theta_sketch::deserialize(bytes.data(), bytes.size());
+      compact_theta_sketch sketch2 = compact_theta_sketch::deserialize(s);
+      auto sketchptr = theta_sketch::deserialize(bytes.data(), bytes.size());
+      s.seekg(0);
+      auto sketchptr2 = theta_sketch::deserialize(s);
+      std::vector<const theta_sketch*> sketches = {&sketch1, &sketch2, sketchptr.get(), sketchptr2.get()};
+      for (const theta_sketch* sketch: sketches) {
+        CPPUNIT_ASSERT(!sketch->is_empty());
+        CPPUNIT_ASSERT(sketch->is_ordered());
+        CPPUNIT_ASSERT_EQUAL(compact_sketch.is_estimation_mode(), sketch->is_estimation_mode());
+        CPPUNIT_ASSERT_EQUAL(compact_sketch.get_theta64(), sketch->get_theta64());
+        CPPUNIT_ASSERT_EQUAL(compact_sketch.get_num_retained(), sketch->get_num_retained());
+        CPPUNIT_ASSERT(std::equal(compact_sketch.begin(), compact_sketch.end(), sketch->begin()));
+      }
+
+      CPPUNIT_ASSERT_THROW(compact_theta_sketch::deserialize(bytes.data(), bytes.size() - 1), std::invalid_argument);
+      CPPUNIT_ASSERT_THROW(compact_theta_sketch::deserialize(bytes.data(), bytes.size(), 123), std::invalid_argument);
+    }
+  }
+
+  void serialize_compressed_fallback() {
+    update_theta_sketch update_sketch = update_theta_sketch::builder().build();
+    // empty
+    auto bytes = update_sketch.compact().serialize_compressed();
+    CPPUNIT_ASSERT_EQUAL(theta_sketch::SERIAL_VERSION, bytes[1]);
+    CPPUNIT_ASSERT(compact_theta_sketch::deserialize(bytes.data(), bytes.size()).is_empty());
+
+    // single item
+    update_sketch.update(1);
+    bytes = update_sketch.compact().serialize_compressed();
+    CPPUNIT_ASSERT_EQUAL(theta_sketch::SERIAL_VERSION, bytes[1]);
+    CPPUNIT_ASSERT_EQUAL(1U, compact_theta_sketch::deserialize(bytes.data(), bytes.size()).get_num_retained());
+
+    // unordered
+    update_sketch.update(2);
+    bytes = update_sketch.compact(false).serialize_compressed();
+    CPPUNIT_ASSERT_EQUAL(theta_sketch::SERIAL_VERSION, bytes[1]);
+    CPPUNIT_ASSERT_EQUAL(2U, compact_theta_sketch::deserialize(bytes.data(), bytes.size()).get_num_retained());
+  }
+
+  void reset() {
+    update_theta_sketch update_sketch = update_theta_sketch::builder().set_p(0.5).build();
+    for (int i = 0; i < 10000; i++) update_sketch.update(i);
+    update_sketch.reset();
+    CPPUNIT_ASSERT(update_sketch.is_empty());
+    CPPUNIT_ASSERT_EQUAL(0U, update_sketch.get_num_retained());
+    CPPUNIT_ASSERT_EQUAL(0.5, update_sketch.get_theta());
+
+    update_theta_sketch fresh_sketch = update_theta_sketch::builder().set_p(0.5).build();
+    for (int i = 0; i < 1000; i++) {
+      update_sketch.update(i);
+      fresh_sketch.update(i);
+    }
+    CPPUNIT_ASSERT_EQUAL(fresh_sketch.get_num_retained(), update_sketch.get_num_retained());
+    CPPUNIT_ASSERT(fresh_sketch.compact().serialize() == update_sketch.compact().serialize());
+  }
+
+  void bucketized_table_layout() {
+    update_theta_sketch strided_sketch = update_theta_sketch::builder().set_lg_k(10).build();
+    update_theta_sketch bucketized_sketch = update_theta_sketch::builder().set_lg_k(10).set_table_layout(update_theta_sketch::BUCKETIZED).build();
+    int value = 0;
+    // through resizing and several rebuilds, the retained keys must be the same
+    for (int n: {10, 100, 1000, 10000, 100000}) {
+      while (value < n) {
+        strided_sketch.update(value);
+        bucketized_sketch.update(value++);
+      }
+      for (int i = 0; i < std::min(n, 100); i++) bucketized_sketch.update(i); // duplicates
+      CPPUNIT_ASSERT_EQUAL(strided_sketch.get_num_retained(), bucketized_sketch.get_num_retained());
+      CPPUNIT_ASSERT(strided_sketch.compact().serialize() == bucketized_sketch.compact().serialize());
+    }
+
+    // serialized in the strided layout
+    auto bytes = bucketized_sketch.serialize();
+    update_theta_sketch deserialized_sketch = update_theta_sketch::deserialize(bytes.data(), bytes.size());
+    CPPUNIT_ASSERT(strided_sketch.compact().serialize() == deserialized_sketch.compact().serialize());
+    deserialized_sketch.update(1); // duplicate must be found in the strided layout
+    CPPUNIT_ASSERT_EQUAL(strided_sketch.get_num_retained(), deserialized_sketch.get_num_retained());
+    std::stringstream s(std::ios::in | std::ios::out | std::ios::binary);
+    bucketized_sketch.serialize(s);
+    CPPUNIT_ASSERT(bytes == update_theta_sketch::deserialize(s).serialize());
+
+    update_theta_sketch copied_sketch(bucketized_sketch);
+    for (int i = 0; i < 100000; i++) {
+      copied_sketch.update(i + 100000);
+      strided_sketch.update(i + 100000);
+    }
+    CPPUNIT_ASSERT(strided_sketch.compact().serialize() == copied_sketch.compact().serialize());
+  }
+
+  void from_hashes() {
+    CPPUNIT_ASSERT(compact_theta_sketch::from_hashes(nullptr, 0).is_empty());
+    const uint64_t zero = 0;
+    compact_theta_sketch sketch = compact_theta_sketch::from_hashes(&zero, 1);
+    CPPUNIT_ASSERT(!sketch.is_empty());
+    CPPUNIT_ASSERT_EQUAL(0U, sketch.get_num_retained());
+    CPPUNIT_ASSERT_THROW(compact_theta_sketch::from_hashes(&zero, 1, 4), std::invalid_argument);
+
+    std::mt19937_64 random(1);
+    for (int n: {100, 1000, 100000}) {
+      for (float p: {1.0f, 0.5f}) {
+        update_theta_sketch update_sketch = update_theta_sketch::builder().set_lg_k(10).set_p(p).set_seed(123).build();
+        std::vector<uint64_t> hashes;
+        for (uint64_t i = 0; i < static_cast<uint64_t>(n); i++) {
+          update_sketch.update(i);
+          HashState hash_state;
+          MurmurHash3_x64_128(&i, sizeof(i), 123, hash_state);
+          hashes.push_back(hash_state.h1 >> 1);
+          if (i % 3 == 0) hashes.push_back(hash_state.h1 >> 1); // duplicates
+        }
+        update_sketch.trim();
+        const auto expected = update_sketch.compact().serialize();
+        std::shuffle(hashes.begin(), hashes.end(), random);
+        sketch = compact_theta_sketch::from_hashes(hashes.data(), hashes.size(), 10, p, 123);
+        CPPUNIT_ASSERT(sketch.is_ordered());
+        CPPUNIT_ASSERT(expected == sketch.serialize());
+        std::sort(hashes.begin(), hashes.end());
+        sketch = compact_theta_sketch::from_hashes(hashes.data(), hashes.size(), 10, p, 123);
+        CPPUNIT_ASSERT(expected == sketch.serialize());
+      }
+    }
+  }
+
+  void adopt_serialized_buffer() {
+    update_theta_sketch update_sketch = update_theta_sketch::builder().build();
+    for (int i = 0; i < 1000; i++) update_sketch.update(i);
+    auto bytes = update_sketch.serialize();
+    const size_t size_longs = bytes.size() / sizeof(uint64_t);
+
+    std::allocator<uint64_t> alloc;
+    uint64_t* buffer = alloc.allocate(size_longs);
+    std::copy(bytes.begin(), bytes.end(), reinterpret_cast<uint8_t*>(buffer));
+    // the size must match the serialized table exactly, the caller keeps the buffer on failure
+    CPPUNIT_ASSERT_THROW(update_theta_sketch::adopt(buffer, size_longs - 1), std::invalid_argument);
+    CPPUNIT_ASSERT_THROW(update_theta_sketch::adopt(buffer, size_longs, 123), std::invalid_argument);
+    // lg_nom_size and lg_cur_size are bytes 3 and 4 of the preamble
+    uint8_t* preamble = reinterpret_cast<uint8_t*>(buffer);
+    const uint8_t lg_nom_size = preamble[3];
+    const uint8_t lg_cur_size = preamble[4];
+    preamble[4] = 64;
+    CPPUNIT_ASSERT_THROW(update_theta_sketch::adopt(buffer, size_longs), std::invalid_argument);
+    preamble[4] = lg_nom_size + 2;
+    CPPUNIT_ASSERT_THROW(update_theta_sketch::adopt(buffer, size_longs), std::invalid_argument);
+    preamble[4] = lg_cur_size;
+    preamble[3] = 27;
+    CPPUNIT_ASSERT_THROW(update_theta_sketch::adopt(buffer, size_longs), std::invalid_argument);
+    preamble[3] = lg_nom_size;
+
+    update_theta_sketch adopted_sketch = update_theta_sketch::adopt(buffer, size_longs);
+    CPPUNIT_ASSERT_EQUAL(update_sketch.get_num_retained(), adopted_sketch.get_num_retained());
+    CPPUNIT_ASSERT(update_sketch.compact().serialize() == adopted_sketch.compact().serialize());
+
+    // copies and assignments must not depend on the adopted buffer
+    update_theta_sketch copy = adopted_sketch;
+    update_theta_sketch assigned = update_theta_sketch::builder().build();
+    assigned = adopted_sketch;
+
+    // keeps updating through resizing and rebuilds, releasing the adopted buffer along the way
+    for (int i = 1000; i < 100000; i++) {
+      update_sketch.update(i);
+      adopted_sketch.update(i);
+    }
+    CPPUNIT_ASSERT(update_sketch.compact().serialize() == adopted_sketch.compact().serialize());
+    CPPUNIT_ASSERT(copy.compact().serialize() == assigned.compact().serialize());
+  }
+
 };
 
 CPPUNIT_TEST_SUITE_REGISTRATION(theta_sketch_test);
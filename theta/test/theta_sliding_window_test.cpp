@@ -0,0 +1,120 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+
+#include <cppunit/TestFixture.h>
+#include <cppunit/extensions/HelperMacros.h>
+
+#include <vector>
+
+#include <theta_sliding_window.hpp>
+
+namespace datasketches {
+
+class theta_sliding_window_test: public CppUnit::TestFixture {
+
+  CPPUNIT_TEST_SUITE(theta_sliding_window_test);
+  CPPUNIT_TEST(invalid);
+  CPPUNIT_TEST(empty);
+  CPPUNIT_TEST(exact_mode);
+  CPPUNIT_TEST(estimation_mode);
+  CPPUNIT_TEST(seed_mismatch);
+  CPPUNIT_TEST_SUITE_END();
+
+  // union of the last num_buckets of the given buckets by the regular union
+  static compact_theta_sketch union_of_last(const std::vector<update_theta_sketch>& buckets, uint32_t num_buckets, uint8_t lg_k) {
+    theta_union u = theta_union::builder().set_lg_k(lg_k).build();
+    for (size_t i = buckets.size() - std::min(buckets.size(), static_cast<size_t>(num_buckets)); i < buckets.size(); i++) {
+      u.update(buckets[i]);
+    }
+    return u.get_result();
+  }
+
+  void invalid() {
+    CPPUNIT_ASSERT_THROW(theta_sliding_window(0), std::invalid_argument);
+    theta_sliding_window window(10);
+    CPPUNIT_ASSERT_THROW(window.get_result(11), std::invalid_argument);
+  }
+
+  void empty() {
+    theta_sliding_window window(10);
+    CPPUNIT_ASSERT_EQUAL(10U, window.get_window_size());
+    CPPUNIT_ASSERT_EQUAL(0U, window.get_num_buckets());
+    CPPUNIT_ASSERT(window.get_result(10).is_empty());
+    window.add_bucket(update_theta_sketch::builder().build());
+    CPPUNIT_ASSERT_EQUAL(1U, window.get_num_buckets());
+    CPPUNIT_ASSERT(window.get_result(10).is_empty());
+    CPPUNIT_ASSERT(window.get_result(0).is_empty());
+  }
+
+  void exact_mode() {
+    const uint32_t window_size = 13;
+    theta_sliding_window window(window_size);
+    std::vector<update_theta_sketch> buckets;
+    int value = 0;
+    for (int i = 0; i < 40; i++) {
+      buckets.push_back(update_theta_sketch::builder().build());
+      for (int j = 0; j < 100; j++) buckets.back().update(value++);
+      value -= 30; // overlap with the next bucket
+      window.add_bucket(buckets.back());
+      for (uint32_t n = 0; n <= window_size; n++) {
+        const compact_theta_sketch expected = union_of_last(buckets, n, update_theta_sketch::builder::DEFAULT_LG_K);
+        const compact_theta_sketch result = window.get_result(n);
+        CPPUNIT_ASSERT(!result.is_estimation_mode());
+        CPPUNIT_ASSERT(result.is_ordered());
+        CPPUNIT_ASSERT_EQUAL(expected.get_estimate(), result.get_estimate());
+      }
+    }
+    CPPUNIT_ASSERT_EQUAL(window_size, window.get_num_buckets());
+  }
+
+  void estimation_mode() {
+    const uint8_t lg_k = 10;
+    const uint32_t window_size = 60;
+    theta_sliding_window window(window_size, lg_k);
+    std::vector<update_theta_sketch> buckets;
+    int value = 0;
+    for (int i = 0; i < 100; i++) {
+      buckets.push_back(update_theta_sketch::builder().set_lg_k(lg_k).build());
+      for (int j = 0; j < 2000; j++) buckets.back().update(value++);
+      window.add_bucket(buckets.back());
+    }
+    for (uint32_t n: {1, 7, 16, 33, 60}) {
+      const compact_theta_sketch result = window.get_result(n);
+      CPPUNIT_ASSERT(result.is_estimation_mode());
+      CPPUNIT_ASSERT(result.get_num_retained() <= 1U << lg_k);
+      CPPUNIT_ASSERT_DOUBLES_EQUAL(n * 2000, result.get_estimate(), n * 2000 * 0.1);
+      const compact_theta_sketch expected = union_of_last(buckets, n, lg_k);
+      CPPUNIT_ASSERT_DOUBLES_EQUAL(expected.get_estimate(), result.get_estimate(), n * 2000 * 0.1);
+    }
+  }
+
+  void seed_mismatch() {
+    update_theta_sketch sketch = update_theta_sketch::builder().set_seed(123).build();
+    theta_sliding_window window(10);
+    window.add_bucket(sketch); // empty is ignored
+    sketch.update(1);
+    CPPUNIT_ASSERT_THROW(window.add_bucket(sketch), std::invalid_argument);
+  }
+
+};
+
+CPPUNIT_TEST_SUITE_REGISTRATION(theta_sliding_window_test);
+
+} /* namespace datasketches */
@@ -32,6 +32,14 @@ class theta_union_test: public CppUnit::TestFixture {
   CPPUNIT_TEST(exact_mode_half_overlap);
   CPPUNIT_TEST(estimation_mode_half_overlap);
   CPPUNIT_TEST(seed_mismatch);
+  CPPUNIT_TEST(wrapped_compact_estimation_mode);
+  CPPUNIT_TEST(merge_ordered_empty);
+  CPPUNIT_TEST(merge_ordered_exact_mode);
+  CPPUNIT_TEST(merge_ordered_estimation_mode);
+  CPPUNIT_TEST(merge_ordered_seed_mismatch);
+  CPPUNIT_TEST(estimation_mode_unordered_and_ordered);
+  CPPUNIT_TEST(reset);
+  CPPUNIT_TEST(get_result_into_buffer);
   CPPUNIT_TEST_SUITE_END();
 
   void empty() {
@@ -98,6 +106,29 @@ class theta_union_test: public CppUnit::TestFixture {
     //sketch3.to_stream(std::cerr, true);
   }
 
+  void wrapped_compact_estimation_mode() {
+    update_theta_sketch sketch1 = update_theta_sketch::builder().build();
+    int value = 0;
+    for (int i = 0; i < 10000; i++) sketch1.update(value++);
+
+    update_theta_sketch sketch2 = update_theta_sketch::builder().build();
+    value = 5000;
+    for (int i = 0; i < 10000; i++) sketch2.update(value++);
+
+    auto bytes1 = sketch1.compact().serialize();
+    auto bytes2 = sketch2.compact(false).serialize();
+    theta_union u = theta_union::builder().build();
+    u.update(wrapped_compact_theta_sketch::wrap(bytes1.data(), bytes1.size()));
+    u.update(wrapped_compact_theta_sketch::wrap(bytes2.data(), bytes2.size()));
+    compact_theta_sketch result = u.get_result();
+
+    theta_union u2 = theta_union::builder().build();
+    u2.update(sketch1);
+    u2.update(sketch2);
+    CPPUNIT_ASSERT_EQUAL(u2.get_result().get_num_retained(), result.get_num_retained());
+    CPPUNIT_ASSERT_EQUAL(u2.get_result().get_theta64(), result.get_theta64());
+  }
+
   void seed_mismatch() {
     update_theta_sketch sketch = update_theta_sketch::builder().build();
     sketch.update(1); // non-empty should not be ignored
@@ -105,6 +136,150 @@ class theta_union_test: public CppUnit::TestFixture {
     CPPUNIT_ASSERT_THROW(u.update(sketch), std::invalid_argument);
   }
 
+  void merge_ordered_empty() {
+    std::vector<compact_theta_sketch> sketches;
+    sketches.push_back(update_theta_sketch::builder().build().compact());
+    theta_union u = theta_union::builder().build();
+    compact_theta_sketch result = u.merge_ordered(sketches.begin(), sketches.end());
+    CPPUNIT_ASSERT(result.is_empty());
+    CPPUNIT_ASSERT(!result.is_estimation_mode());
+    CPPUNIT_ASSERT_EQUAL(0U, result.get_num_retained());
+  }
+
+  void merge_ordered_exact_mode() {
+    std::vector<compact_theta_sketch> sketches;
+    int value = 0;
+    for (int i = 0; i < 10; i++) {
+      update_theta_sketch update_sketch = update_theta_sketch::builder().build();
+      for (int j = 0; j < 200; j++) update_sketch.update(value++);
+      value -= 100; // half overlap with the next sketch
+      sketches.push_back(update_sketch.compact());
+    }
+    theta_union u = theta_union::builder().build();
+    for (auto& sketch: sketches) u.update(sketch);
+    compact_theta_sketch result1 = u.get_result();
+    compact_theta_sketch result2 = theta_union::builder().build().merge_ordered(sketches.begin(), sketches.end());
+    CPPUNIT_ASSERT(!result2.is_empty());
+    CPPUNIT_ASSERT(!result2.is_estimation_mode());
+    CPPUNIT_ASSERT(result2.is_ordered());
+    CPPUNIT_ASSERT_EQUAL(1100U, result2.get_num_retained());
+    CPPUNIT_ASSERT_EQUAL(result1.get_num_retained(), result2.get_num_retained());
+    auto iter = result1.begin();
+    for (auto key: result2) {
+      CPPUNIT_ASSERT_EQUAL(*iter, key);
+      ++iter;
+    }
+  }
+
+  void merge_ordered_estimation_mode() {
+    std::vector<compact_theta_sketch> sketches;
+    int value = 0;
+    for (int i = 0; i < 10; i++) {
+      update_theta_sketch sketch = update_theta_sketch::builder().build();
+      for (int j = 0; j < 10000; j++) sketch.update(value++);
+      value -= 5000; // half overlap with the next sketch
+      sketches.push_back(sketch.compact());
+    }
+    // unordered inputs and the current state of the union are merged too
+    update_theta_sketch update_sketch = update_theta_sketch::builder().build();
+    for (int j = 0; j < 10000; j++) update_sketch.update(value++);
+    std::vector<const theta_sketch*> sketch_ptrs;
+    for (auto& sketch: sketches) sketch_ptrs.push_back(&sketch);
+    sketch_ptrs.push_back(&update_sketch);
+    theta_union u = theta_union::builder().build();
+    u.update(sketches[0]);
+    compact_theta_sketch result = u.merge_ordered(sketch_ptrs.begin(), sketch_ptrs.end());
+    CPPUNIT_ASSERT(!result.is_empty());
+    CPPUNIT_ASSERT(result.is_estimation_mode());
+    CPPUNIT_ASSERT(result.is_ordered());
+    CPPUNIT_ASSERT_EQUAL(1U << update_theta_sketch::builder::DEFAULT_LG_K, result.get_num_retained());
+    CPPUNIT_ASSERT_DOUBLES_EQUAL(60000, result.get_estimate(), 60000 * 0.05);
+    uint64_t previous = 0;
+    for (auto key: result) {
+      CPPUNIT_ASSERT(key > previous);
+      CPPUNIT_ASSERT(key < result.get_theta64());
+      previous = key;
+    }
+
+    for (auto& sketch: sketches) u.update(sketch);
+    u.update(update_sketch);
+    CPPUNIT_ASSERT_DOUBLES_EQUAL(u.get_result().get_estimate(), result.get_estimate(), 60000 * 0.05);
+  }
+
+  void merge_ordered_seed_mismatch() {
+    std::vector<compact_theta_sketch> sketches;
+    update_theta_sketch sketch = update_theta_sketch::builder().build();
+    sketch.update(1); // non-empty should not be ignored
+    sketches.push_back(sketch.compact());
+    theta_union u = theta_union::builder().set_seed(123).build();
+    CPPUNIT_ASSERT_THROW(u.merge_ordered(sketches.begin(), sketches.end()), std::invalid_argument);
+  }
+
+  void estimation_mode_unordered_and_ordered() {
+    // decreasing theta, so that late sketches are mostly filtered out
+    std::vector<update_theta_sketch> sketches;
+    for (int i = 0; i < 8; i++) {
+      sketches.push_back(update_theta_sketch::builder().set_lg_k(10 - i % 3).build());
+      for (int j = 0; j < 5000 * (i + 1); j++) sketches.back().update(j);
+    }
+    theta_union u1 = theta_union::builder().set_lg_k(10).build();
+    theta_union u2 = theta_union::builder().set_lg_k(10).build();
+    theta_union u3 = theta_union::builder().set_lg_k(10).build();
+    for (const auto& sketch: sketches) {
+      u1.update(sketch);
+      u2.update(sketch.compact(false));
+      u3.update(sketch.compact(true));
+    }
+    const auto bytes = u3.get_result().serialize();
+    CPPUNIT_ASSERT(bytes == u1.get_result().serialize());
+    CPPUNIT_ASSERT(bytes == u2.get_result().serialize());
+    CPPUNIT_ASSERT_DOUBLES_EQUAL(40000, u1.get_result().get_estimate(), 40000 * 0.1);
+  }
+
+  void reset() {
+    update_theta_sketch sketch1 = update_theta_sketch::builder().build();
+    for (int i = 0; i < 10000; i++) sketch1.update(i);
+    update_theta_sketch sketch2 = update_theta_sketch::builder().build();
+    for (int i = 0; i < 100; i++) sketch2.update(i);
+
+    theta_union u = theta_union::builder().build();
+    u.update(sketch1);
+    u.reset();
+    CPPUNIT_ASSERT(u.get_result().is_empty());
+    u.update(sketch2);
+
+    theta_union fresh_union = theta_union::builder().build();
+    fresh_union.update(sketch2);
+    CPPUNIT_ASSERT(fresh_union.get_result().serialize() == u.get_result().serialize());
+  }
+
+  void get_result_into_buffer() {
+    theta_union u = theta_union::builder().build();
+    std::vector<uint64_t> buffer(u.get_max_result_size_bytes() / sizeof(uint64_t));
+    size_t size = u.get_result(buffer.data(), buffer.size() * sizeof(uint64_t));
+    CPPUNIT_ASSERT(wrapped_compact_theta_sketch::wrap(buffer.data(), size).is_empty());
+
+    update_theta_sketch sketch1 = update_theta_sketch::builder().build();
+    for (int i = 0; i < 10000; i++) sketch1.update(i);
+    update_theta_sketch sketch2 = update_theta_sketch::builder().build();
+    for (int i = 5000; i < 15000; i++) sketch2.update(i);
+    u.update(sketch1);
+    u.update(sketch2);
+
+    CPPUNIT_ASSERT_THROW(u.get_result(buffer.data(), buffer.size() * sizeof(uint64_t)), std::invalid_argument);
+    buffer.resize(u.get_max_result_size_bytes() / sizeof(uint64_t));
+    for (bool ordered: {true, false}) {
+      size = u.get_result(buffer.data(), buffer.size() * sizeof(uint64_t), ordered);
+      auto bytes = u.get_result(ordered).serialize();
+      CPPUNIT_ASSERT_EQUAL(bytes.size(), size);
+      const uint8_t* ptr = reinterpret_cast<const uint8_t*>(buffer.data());
+      if (ordered) CPPUNIT_ASSERT(std::equal(bytes.begin(), bytes.end(), ptr));
+      auto wrapped = wrapped_compact_theta_sketch::wrap(buffer.data(), size);
+      CPPUNIT_ASSERT_EQUAL(ordered, wrapped.is_ordered());
+      CPPUNIT_ASSERT_EQUAL(u.get_result().get_estimate(), wrapped.get_estimate());
+    }
+  }
+
 };
 
 CPPUNIT_TEST_SUITE_REGISTRATION(theta_union_test);